@@ -2,10 +2,14 @@
 #include <string.h>
 #include <math.h>
 #include <stdlib.h>
+#include <time.h>
 
 #include "csynth.h"
 #include "uris.h"
 #include "patch.h"
+#include "voices.h"
+#include "stats.h"
+#include "cv.h"
 
 #include "lv2/lv2plug.in/ns/lv2core/lv2.h"
 #include "lv2/lv2plug.in/ns/ext/atom/atom.h"
@@ -24,16 +28,39 @@ typedef enum {
 	CSYNTH_OUT     = 2
 } PortIndex;
 
+// the time in seconds to fade out a voice when reducing load
+#define GOVERNOR_FADE_TIME 0.01
+// the time in seconds to wait after an overload before restoring a voice
+#define GOVERNOR_HOLD_TIME 0.5
+// the fraction of the load ceiling the load must stay below to restore voices
+#define GOVERNOR_HEADROOM 0.75
+// the portion of each block's load to mix into the smoothed load
+#define GOVERNOR_SMOOTHING 0.1
+// the number of blocks in a row that must go over the load ceiling before 
+//  voices are cut, so one slow block doesn't cost voices
+#define GOVERNOR_OVERLOAD_BLOCKS 3
+
+// the seconds of audio between profiling reports
+#define PROFILE_REPORT_INTERVAL 2.0
+// the maximum length of a profiling report
+#define PROFILE_REPORT_LEN 2048
+
+// the most samples per block that can be crossfaded when swapping patches, 
+//  with longer blocks swapping patches immediately
+#define CROSSFADE_BUFFER_LEN 8192
+
+// the grid in samples that control events are moved to, so that bursts of 
+//  automation don't split a block into many tiny renders
+#define EVENT_GRID 16
+
+// the maximum length of the status line added after compiler output
+#define BUILD_STATUS_LEN 128
+
+// a message from the worker with the text of a profiling report
 typedef struct {
-  // the currently playing MIDI node number
-  uint8_t note;
-  // note frequency in Hz
-	float frequency;
-	// note velocity (0.0 to 1.0)
-	float velocity;
-	// an index tracking when the voice was last used
-	int allocation_index;
-} Voice;
+	LV2_Atom atom;
+	char text[PROFILE_REPORT_LEN];
+} ReportAtom;
 
 typedef struct {
   // port buffers
@@ -53,33 +80,84 @@ typedef struct {
 	LV2_Atom_Forge_Frame notify_frame;
 	// the patch in current use
 	Patch *patch;
+	// the previous patch while it's being faded out after a new patch loads
+	Patch *old_patch;
+	// the time in seconds to fade between patches
+	float crossfade_time;
+	// how far the current crossfade has progressed, from 0.0 to 1.0
+	float crossfade;
+	// the output of the previous patch while it's being faded out
+	float crossfade_buffer[CROSSFADE_BUFFER_LEN];
 	// whether to autobuild the patch
 	int autobuild;
+	// whether to build patches with profiling counters
+	int profile;
+	// the seconds of audio since the last profiling report was requested
+	double profile_time;
+	// the most recent profiling report
+	char profile_report[PROFILE_REPORT_LEN];
+	// the number of builds requested by the audio thread and the number the 
+	//  worker has started, so the worker can tell when a build is superseded
+	int builds_requested;
+	int builds_started;
+	// compiler output or status from the most recent build
+	char build_output[PATCH_OUTPUT_BUFFER_LEN+BUILD_STATUS_LEN+1];
+	// the files the most recent build depended on, separated by newlines
+	char dependencies[PATCH_DEPENDENCY_BUFFER_LEN+1];
 	// the number of voices to allow
 	int polyphony;
 	// the maximum range of a pitch bend in semitones
 	float bendrange;
+	// the fraction of the realtime budget that processing is allowed to use
+	float load_ceiling;
+	// the smoothed fraction of the realtime budget used by recent blocks
+	float load;
+	// the time in seconds until the governor can restore another voice
+	double governor_hold;
+	// the number of blocks in a row that have gone over the load ceiling, 
+	//  and the lowest load among them
+	int overload_blocks;
+	float overload;
+	// processing load statistics and a buffer for sending them
+	LoadStats load_stats;
+	float load_stats_array[LOAD_STAT_COUNT];
+	int load_stats_indices[LOAD_STAT_COUNT];
 	// whether properties have changed independent of the gui
 	int send_patch_change_to_gui;
 	int send_autobuild_change_to_gui;
+	int send_profile_change_to_gui;
+	int send_profile_report_to_gui;
+	int send_build_output_to_gui;
+	int send_dependencies_to_gui;
 	int send_polyphony_change_to_gui;
 	int send_bendrange_change_to_gui;
+	int send_crossfade_change_to_gui;
+	int send_stealing_change_to_gui;
+	int send_load_ceiling_change_to_gui;
+	int send_voice_limit_change_to_gui;
+	int send_load_stats_to_gui;
 	int send_cv_change_to_gui;
 	int set_cv_indices[CV_COUNT];
 	int set_cv_count;
 	// current control values (0.0 to 1.0)
 	float cv[CV_COUNT];
+	// control values as patches see them, ramping smoothly to new values
+	CVRamps cv_ramps;
 	// current pitch bend (unscaled from -1.0 to 1.0)
 	float bend;
 	// current pitch bend (scaled to semitones)
 	float bend_scaled;
 	// synth voices
-	Voice voices[MAX_VOICE_COUNT];
-	int voice_allocation_index;
+	VoiceManager voices;
 } Csynth;
 
 // forward declarations
 static inline void update_bend(Csynth*, float, float);
+static inline void update_polyphony(Csynth*, int);
+static inline void update_stealing(Csynth*, int);
+static inline void update_load_ceiling(Csynth*, float);
+static inline void update_crossfade_time(Csynth*, float);
+static void request_patch_resize(Csynth*, Patch*);
 
 // LIFECYCLE ******************************************************************
 
@@ -115,6 +193,18 @@ static LV2_Handle instantiate(const LV2_Descriptor *descriptor, double rate,
 	lv2_atom_forge_init(&self->forge, self->map);
 	// save the length of a sample
 	self->time_step = 1.0 / rate;
+	init_cv_ramps(&self->cv_ramps, self->time_step);
+	// set up voices
+	init_voices(&self->voices);
+	self->voices.fade_step = self->time_step / GOVERNOR_FADE_TIME;
+	update_polyphony(self, self->polyphony);
+	self->load_ceiling = 0.8;
+	self->crossfade_time = 0.05;
+	// set up load statistics
+	init_load_stats(&self->load_stats);
+	for (int i = 0; i < LOAD_STAT_COUNT; i++) {
+	  self->load_stats_indices[i] = i;
+	}
 	// save the path to the bundle
 	self->bundle_path = bundle_path;
 	return((LV2_Handle)self);
@@ -128,6 +218,7 @@ static void deactivate(LV2_Handle instance) {
 
 static void cleanup(LV2_Handle instance) {
   Csynth* self = (Csynth*)instance;
+  dispose_patch(self->old_patch);
   dispose_patch(self->patch);
 	free(self);
 }
@@ -158,21 +249,42 @@ static inline void receive_atom_object(Csynth* self, const LV2_Atom_Object* obj)
     if (value != NULL) {
       // compile new code outside the realtime audio thread
       if (key == self->uris.csynth_codepath) {
-        self->schedule->schedule_work(self->schedule->handle,
-					                            lv2_atom_total_size((LV2_Atom *)obj), obj);
+        // count the request so the worker can skip or stop older builds
+        if (self->schedule->schedule_work(self->schedule->handle,
+              lv2_atom_total_size((LV2_Atom *)obj), obj) == LV2_WORKER_SUCCESS) {
+          __atomic_add_fetch(&self->builds_requested, 1, __ATOMIC_RELEASE);
+        }
       }
       // read CV changes
       else if (key == self->uris.csynth_cv) {
         const LV2_Atom_Tuple *tuple = (const LV2_Atom_Tuple *)value;
         read_set_float_array(&self->uris, tuple, CV_COUNT, self->cv);
+        set_all_cv(&self->cv_ramps, self->cv);
       }
       // read autobuild changes
       else if (key == self->uris.csynth_autobuild) {
         self->autobuild = *((int *)LV2_ATOM_BODY(value));
       }
+      // read profiling changes, which take effect on the next build
+      else if (key == self->uris.csynth_profile) {
+        self->profile = *((int *)LV2_ATOM_BODY(value));
+      }
       // read polyphony changes
       else if (key == self->uris.csynth_polyphony) {
-        self->polyphony = *((int *)LV2_ATOM_BODY(value));
+        update_polyphony(self, *((int *)LV2_ATOM_BODY(value)));
+        request_patch_resize(self, self->patch);
+      }
+      // read voice stealing changes
+      else if (key == self->uris.csynth_stealing) {
+        update_stealing(self, *((int *)LV2_ATOM_BODY(value)));
+      }
+      // read load ceiling changes
+      else if (key == self->uris.csynth_loadceiling) {
+        update_load_ceiling(self, *((float *)LV2_ATOM_BODY(value)));
+      }
+      // read crossfade time changes
+      else if (key == self->uris.csynth_crossfade) {
+        update_crossfade_time(self, *((float *)LV2_ATOM_BODY(value)));
       }
       // read bend-range changes
       else if (key == self->uris.csynth_bendrange) {
@@ -184,8 +296,16 @@ static inline void receive_atom_object(Csynth* self, const LV2_Atom_Object* obj)
   if (obj->body.otype == self->uris.patch_Get) {
     self->send_patch_change_to_gui = true;
     self->send_autobuild_change_to_gui = true;
+    self->send_profile_change_to_gui = true;
+    if (strlen(self->dependencies) > 0) {
+      self->send_dependencies_to_gui = true;
+    }
     self->send_polyphony_change_to_gui = true;
     self->send_bendrange_change_to_gui = true;
+    self->send_crossfade_change_to_gui = true;
+    self->send_stealing_change_to_gui = true;
+    self->send_load_ceiling_change_to_gui = true;
+    self->send_voice_limit_change_to_gui = true;
     for (int i = 0; i < CV_COUNT; i++) {
       self->set_cv_indices[i] = i;
     }
@@ -196,22 +316,13 @@ static inline void receive_atom_object(Csynth* self, const LV2_Atom_Object* obj)
 
 // MIDI PROCESSING ************************************************************
 
-static inline float note_number_to_frequency(float note) {
-	return(440.0 * powf(2.0, (note - 69) / 12.0));
-}
-
 // update the current bend value, applying it to all voices
 static inline void update_bend(Csynth* self, float bend, float bendrange) {
   if ((bend != self->bend) || (bendrange != self->bendrange)) {
     self->bend = bend;
     self->bendrange = bendrange;
     self->bend_scaled = bend * bendrange;
-    for (int i = 0; i < MAX_VOICE_COUNT; i++) {
-      if (self->voices[i].note > 0) {
-        self->voices[i].frequency = 
-          note_number_to_frequency(self->voices[i].note + self->bend_scaled);
-      }
-    }
+    bend_voices(&self->voices, self->bend_scaled);
   }
 }
 
@@ -224,54 +335,87 @@ static inline int get_voice_count(Csynth* self) {
   return(voices);
 }
 
-// allocate a voice index to play a note
-static inline int allocate_voice(Csynth* self) {
-  // select the least recently used voice that isn't currently playing
-  int index = 0;
-  int minimum_index = -1;
-  for (int i = 0; i < get_voice_count(self); i++) {
-    if (self->voices[i].velocity > 0.0) continue;
-    if ((minimum_index < 0) || 
-        (self->voices[i].allocation_index < minimum_index)) {
-      minimum_index = self->voices[i].allocation_index;
-      index = i;
-    }
+// update the number of voices to allow
+static inline void update_polyphony(Csynth* self, int polyphony) {
+  self->polyphony = polyphony;
+  set_voice_count(&self->voices, get_voice_count(self));
+  self->send_voice_limit_change_to_gui = true;
+}
+
+// update the policy for stealing voices
+static inline void update_stealing(Csynth* self, int policy) {
+  if ((policy < 0) || (policy >= STEAL_POLICY_COUNT)) policy = STEAL_OLDEST;
+  self->voices.steal_policy = (StealPolicy)policy;
+}
+
+// update the fraction of the realtime budget processing is allowed to use
+static inline void update_load_ceiling(Csynth* self, float ceiling) {
+  if (ceiling < 0.1) ceiling = 0.1;
+  if (ceiling > 1.0) ceiling = 1.0;
+  self->load_ceiling = ceiling;
+}
+
+// update the time to fade between patches
+static inline void update_crossfade_time(Csynth* self, float time) {
+  if (! (time > 0.0)) time = 0.0;
+  if (time > 1.0) time = 1.0;
+  self->crossfade_time = time;
+}
+
+// tell the voice of each loaded patch that it's starting a note, and 
+//  whether it was still holding another one
+static void send_note_on(Csynth* self, int v, float velocity, int retrigger) {
+  Patch *patches[2] = { self->patch, self->old_patch };
+  for (int i = 0; i < 2; i++) {
+    Patch *patch = patches[i];
+    if ((patch == NULL) || (! patch->loaded) || (patch->note_on == NULL) ||
+        (v >= patch->polyphony)) continue;
+    patch->note_on(patch->context, v, velocity, retrigger);
   }
-  self->voices[index].allocation_index = self->voice_allocation_index++;
-  return(index);
+}
+
+// tell the voice of each loaded patch that its note was released
+static void send_note_off(Csynth* self, int v) {
+  Patch *patches[2] = { self->patch, self->old_patch };
+  for (int i = 0; i < 2; i++) {
+    Patch *patch = patches[i];
+    if ((patch == NULL) || (! patch->loaded) || (patch->note_off == NULL) ||
+        (v >= patch->polyphony)) continue;
+    patch->note_off(patch->context, v);
+  }
+}
+
+// start a note and tell the voice playing it
+static void start_note(Csynth* self, uint8_t note, float velocity) {
+  int v = note_on(&self->voices, note, velocity);
+  if (v == NO_VOICE) return;
+  send_note_on(self, v, velocity, self->voices.voices[v].retriggered);
+}
+
+// release a note and tell the voices that were holding it
+static void stop_note(Csynth* self, uint8_t note) {
+  VoiceManager *vm = &self->voices;
+  for (int v = vm->held[note]; v != NO_VOICE; v = vm->voices[v].next_held) {
+    send_note_off(self, v);
+  }
+  note_off(vm, note);
 }
 
 static inline void receive_midi_event(Csynth* self, const uint8_t* const msg) {
-  int voice;
-  uint8_t note, controller;
+  uint8_t controller;
   float bend;
   switch(lv2_midi_message_type(msg)) {
     case LV2_MIDI_MSG_NOTE_ON:
-      // allocate a voice for the note
-      voice = allocate_voice(self);
-      note = msg[1];
-      self->voices[voice].note = note;
-      self->voices[voice].frequency = 
-        note_number_to_frequency(note + self->bend_scaled);
-      self->voices[voice].velocity = (float)msg[2] / 127.0;
+      // a note-on with zero velocity is a note-off by convention
+      if (msg[2] == 0) stop_note(self, msg[1]);
+      else start_note(self, msg[1], (float)msg[2] / 127.0);
       break;
     case LV2_MIDI_MSG_NOTE_PRESSURE:
-      note = msg[1];
       // pressure modifies the velocity of all matching notes
-      for (voice = 0; voice < MAX_VOICE_COUNT; voice++) {
-        if ((self->voices[voice].note == note) && 
-            (self->voices[voice].velocity > 0.0) && (msg[2] > 0)) {
-          self->voices[voice].velocity = (float)msg[2] / 127.0;
-        }
-      }
+      note_pressure(&self->voices, msg[1], (float)msg[2] / 127.0);
       break;
 		case LV2_MIDI_MSG_NOTE_OFF:
-		  note = msg[1];
-		  for (voice = 0; voice < MAX_VOICE_COUNT; voice++) {
-		    if (self->voices[voice].note == note) {
-		      self->voices[voice].velocity = 0.0;
-		    }
-		  }
+		  stop_note(self, msg[1]);
 		  break;
 		case LV2_MIDI_MSG_BENDER:
 		  bend = (float)(((int)msg[1] | ((int)msg[2] << 7)) - 0x2000);
@@ -284,6 +428,7 @@ static inline void receive_midi_event(Csynth* self, const uint8_t* const msg) {
 		  controller = msg[1];
 		  if ((controller >= 0) && (controller < CV_COUNT)) {
 		    self->cv[controller] = (float)msg[2] / 127.0;
+		    set_cv(&self->cv_ramps, controller, self->cv[controller]);
 		    self->send_cv_change_to_gui = true;
 		    int found = 0;
 		    for (int i = 0; i < self->set_cv_count; i++) {
@@ -306,31 +451,246 @@ static inline void receive_midi_event(Csynth* self, const uint8_t* const msg) {
 
 // AUDIO PROCESSING ***********************************************************
 
-static void write_samples(Csynth* self, uint32_t start, uint32_t end) {
-  // if we have no patch, fill with zeros
-  if ((! self->patch) || (! self->patch->loaded)) {
-    memset(self->out + start, 0, (end - start) * sizeof(float));
+// render a block of samples from one voice of a patch
+static inline void render_voice(Patch *patch, int index, Voice *voice, 
+                                float *cv, float *buffer, uint32_t count) {
+  if (patch->render != NULL) {
+    patch->render(patch->context, index, voice->frequency, voice->velocity, 
+                  cv, buffer, count);
     return;
   }
-  float *p = self->out + start;
+  for (uint32_t i = 0; i < count; i++) {
+    buffer[i] = patch->step(patch->context, index, 
+      voice->frequency, voice->velocity, cv + (i * CV_COUNT));
+  }
+}
+
+// render the voices of a patch into the given buffer using the current 
+//  frame of controller values, updating voice levels and fades only if the 
+//  patch is the one voices are tracked for
+static void write_patch_samples(Csynth* self, Patch *patch, float *out,
+                                uint32_t start, uint32_t count, 
+                                int update_voices) {
+  float *p = out + start;
+  memset(p, 0, count * sizeof(float));
+  // if we have no patch, leave the zeros
+  if ((! patch) || (! patch->loaded)) return;
+  int indices[MAX_VOICE_COUNT];
+  int voice_count = list_voices(&self->voices, 
+    HELD_VOICES, RELEASED_VOICES, indices);
+  int fading[MAX_VOICE_COUNT];
+  int fading_count = list_voices(&self->voices, 
+    FADING_VOICES, FADING_VOICES, fading);
+  float *cv = &self->cv_ramps.frames[0][0];
+  float buffer[CV_FRAME_COUNT];
+  // evaluate modulators shared by all voices once for the frame
+  if (patch->modulate != NULL) patch->modulate(patch->context, count);
+  float fade_step = self->voices.fade_step;
+  float gain, level;
   int v;
-  Voice voice;
-  int voice_count = get_voice_count(self);
-  float sample;
-  for (uint32_t i = start; i < end; i++) {
-    sample = 0.0;
-    for (v = 0; v < voice_count; v++) {
-      voice = self->voices[v];
-      sample += self->patch->step(v, 
-        voice.frequency, voice.velocity, self->cv);
+  uint32_t i;
+  Voice *voice;
+  // render each voice in turn so its state stays in cache for the block
+  for (v = 0; v < voice_count; v++) {
+    // skip voices the patch doesn't have until it's been resized
+    if (indices[v] >= patch->polyphony) continue;
+    voice = &self->voices.voices[indices[v]];
+    render_voice(patch, indices[v], voice, cv, buffer, count);
+    level = 0.0;
+    for (i = 0; i < count; i++) {
+      p[i] += buffer[i];
+      level += fabsf(buffer[i]);
+    }
+    if (update_voices) voice->level_sum += level;
+  }
+  // ramp down voices being faded out by the governor
+  for (v = 0; v < fading_count; v++) {
+    if (fading[v] >= patch->polyphony) continue;
+    voice = &self->voices.voices[fading[v]];
+    gain = voice->gain;
+    if (! (gain > 0.0)) continue;
+    render_voice(patch, fading[v], voice, cv, buffer, count);
+    for (i = 0; (i < count) && (gain > 0.0); i++) {
+      p[i] += buffer[i] * gain;
+      gain -= fade_step;
     }
-    *p++ = sample;
+    if (update_voices) voice->gain = gain;
+  }
+}
+
+// run a patch's master section on the mix of all its voices, using the 
+//  current frame of controller values
+static inline void write_master_samples(Csynth* self, Patch *patch, 
+                                        float *out, uint32_t start, 
+                                        uint32_t count) {
+  if ((! patch) || (! patch->loaded) || (patch->master == NULL)) return;
+  patch->master(patch->context, out + start, count, 
+                &self->cv_ramps.frames[0][0]);
+}
+
+static void write_samples(Csynth* self, uint32_t start, uint32_t end) {
+  // render in frames short enough to hold controller values for each sample
+  while (start < end) {
+    uint32_t count = end - start;
+    if (count > CV_FRAME_COUNT) count = CV_FRAME_COUNT;
+    fill_cv_frames(&self->cv_ramps, count);
+    // render the outgoing patch separately while crossfading, leaving the 
+    //  current patch to update the voices
+    if (self->old_patch != NULL) {
+      write_patch_samples(self, self->old_patch, self->crossfade_buffer, 
+                          start, count, false);
+      write_master_samples(self, self->old_patch, self->crossfade_buffer, 
+                           start, count);
+    }
+    write_patch_samples(self, self->patch, self->out, start, count, true);
+    write_master_samples(self, self->patch, self->out, start, count);
+    start += count;
+  }
+}
+
+// send a patch to the worker to be disposed of
+static void dispose_patch_later(Csynth* self, Patch *patch) {
+  PatchAtom msg = { 
+      { sizeof(Patch *), self->uris.csynth_disposeLib },
+      patch
+    };
+  self->schedule->schedule_work(self->schedule->handle, sizeof(msg), &msg);
+}
+
+// send the patch being faded out to the worker to be disposed of
+static void retire_old_patch(Csynth* self) {
+  if (self->old_patch == NULL) return;
+  // a patch being resized is disposed of when its new voices come back, 
+  //  so they don't outlive the library they came from
+  if (self->old_patch->resizing) self->old_patch->retired = 1;
+  else dispose_patch_later(self, self->old_patch);
+  self->old_patch = NULL;
+}
+
+// have the worker make more voices for a patch if it has fewer than the 
+//  current polyphony
+static void request_patch_resize(Csynth* self, Patch *patch) {
+  if ((patch == NULL) || (! patch->loaded) || (patch->resizing)) return;
+  int polyphony = get_voice_count(self);
+  if (patch->polyphony >= polyphony) return;
+  ContextAtom msg = { 
+      { sizeof(ContextAtom) - sizeof(LV2_Atom), 
+        self->uris.csynth_resizeContext },
+      patch, NULL, polyphony
+    };
+  if (self->schedule->schedule_work(self->schedule->handle, 
+        sizeof(msg), &msg) == LV2_WORKER_SUCCESS) {
+    patch->resizing = 1;
   }
 }
 
+// mix the outgoing patch into the output, fading it out over the 
+//  crossfade time and retiring it when it's silent
+static void write_crossfade(Csynth* self, uint32_t sample_count) {
+  if (self->old_patch == NULL) return;
+  float step = (self->crossfade_time > 0.0) ? 
+    (float)(self->time_step / self->crossfade_time) : 1.0;
+  float mix = self->crossfade;
+  for (uint32_t i = 0; i < sample_count; i++) {
+    mix += step;
+    if (mix > 1.0) mix = 1.0;
+    self->out[i] = (self->out[i] * mix) + 
+                   (self->crossfade_buffer[i] * (1.0 - mix));
+  }
+  self->crossfade = mix;
+  if (self->crossfade >= 1.0) retire_old_patch(self);
+}
+
+// GOVERNOR *******************************************************************
+
+// get a monotonic time in seconds for measuring processing time
+static inline double get_time() {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return((double)t.tv_sec + ((double)t.tv_nsec * 1.0e-9));
+}
+
+// limit the number of sounding voices based on the time it took to 
+//  process a block relative to the time it represents
+static inline void govern_polyphony(Csynth* self, double elapsed, 
+                                    uint32_t sample_count) {
+  if (sample_count == 0) return;
+  VoiceManager *vm = &self->voices;
+  double budget = (double)sample_count * self->time_step;
+  float load = (float)(elapsed / budget);
+  int limit = vm->voice_limit;
+  self->load += (load - self->load) * GOVERNOR_SMOOTHING;
+  // when the load stays over the ceiling, cut voices in proportion to the 
+  //  smallest overload in the run
+  if (load > self->load_ceiling) {
+    if ((self->overload_blocks == 0) || (load < self->overload)) {
+      self->overload = load;
+    }
+    self->overload_blocks++;
+    if (self->overload_blocks >= GOVERNOR_OVERLOAD_BLOCKS) {
+      int sounding = sounding_voice_count(vm);
+      if (sounding > 1) {
+        limit = (int)((float)sounding * (self->load_ceiling / self->overload));
+        if (limit >= sounding) limit = sounding - 1;
+        if (limit < 1) limit = 1;
+        while ((sounding > limit) && (fade_quietest_voice(vm))) sounding--;
+      }
+      self->overload_blocks = 0;
+    }
+    self->governor_hold = GOVERNOR_HOLD_TIME;
+  }
+  // restore voices one at a time while there's headroom
+  else if (limit < vm->voice_count) {
+    self->overload_blocks = 0;
+    self->governor_hold -= budget;
+    if ((self->governor_hold <= 0.0) && 
+        (self->load < self->load_ceiling * GOVERNOR_HEADROOM)) {
+      limit++;
+      self->governor_hold = GOVERNOR_HOLD_TIME;
+    }
+  }
+  else self->overload_blocks = 0;
+  if (limit != vm->voice_limit) {
+    vm->voice_limit = limit;
+    self->send_voice_limit_change_to_gui = true;
+  }
+}
+
+// EVENT SCHEDULING ***********************************************************
+
+// get whether an event needs to happen at its exact time, which is only 
+//  true of notes starting and stopping
+static inline int is_timed_event(Csynth* self, const LV2_Atom_Event *ev) {
+  if (ev->body.type != self->uris.midi_Event) return(false);
+  const uint8_t* const msg = (const uint8_t*)(ev + 1);
+  switch (lv2_midi_message_type(msg)) {
+    case LV2_MIDI_MSG_NOTE_ON:
+    case LV2_MIDI_MSG_NOTE_OFF:
+      return(true);
+    default:
+      return(false);
+  }
+}
+
+// get the sample to render up to before handling an event, moving control 
+//  events back to the nearest grid line so they're handled together
+static inline uint32_t schedule_event(Csynth* self, const LV2_Atom_Event *ev, 
+                                      uint32_t start_sample, 
+                                      uint32_t sample_count) {
+  uint32_t event_sample = ev->time.frames;
+  if (event_sample > sample_count) event_sample = sample_count;
+  if (! is_timed_event(self, ev)) {
+    event_sample -= event_sample % EVENT_GRID;
+  }
+  // never go back before samples already rendered
+  if (event_sample < start_sample) event_sample = start_sample;
+  return(event_sample);
+}
+
 static void run(LV2_Handle instance, uint32_t sample_count) {
 	Csynth* self = (Csynth*)instance;
 	uint32_t start_sample = 0;
+	double start_time = get_time();
 	
 	// prepare to send output data on the notify port
 	const uint32_t notify_capacity = self->notify->atom.size;
@@ -353,6 +713,34 @@ static void run(LV2_Handle instance, uint32_t sample_count) {
 	                self->uris.csynth_autobuild, self->autobuild);
 	  self->send_autobuild_change_to_gui = false;
 	}
+	// if profiling has changed, send it to the GUI
+	if (self->send_profile_change_to_gui) {
+	  lv2_atom_forge_frame_time(&self->forge, 0);
+	  write_set_int(&self->forge, &self->uris, 
+	                self->uris.csynth_profile, self->profile);
+	  self->send_profile_change_to_gui = false;
+	}
+	// if there's a new profiling report, send it to the GUI
+	if (self->send_profile_report_to_gui) {
+	  lv2_atom_forge_frame_time(&self->forge, 0);
+	  write_set_string(&self->forge, &self->uris, 
+	                   self->uris.csynth_profilereport, self->profile_report);
+	  self->send_profile_report_to_gui = false;
+	}
+	// if a build has finished, send its output to the GUI
+	if (self->send_build_output_to_gui) {
+	  lv2_atom_forge_frame_time(&self->forge, 0);
+	  write_set_string(&self->forge, &self->uris, 
+	                   self->uris.csynth_buildoutput, self->build_output);
+	  self->send_build_output_to_gui = false;
+	}
+	// if the files the patch depends on have changed, send them to the GUI
+	if (self->send_dependencies_to_gui) {
+	  lv2_atom_forge_frame_time(&self->forge, 0);
+	  write_set_string(&self->forge, &self->uris, 
+	                   self->uris.csynth_dependencies, self->dependencies);
+	  self->send_dependencies_to_gui = false;
+	}
 	// if polyphony has changed, send it to the GUI
 	if (self->send_polyphony_change_to_gui) {
 	  lv2_atom_forge_frame_time(&self->forge, 0);
@@ -367,6 +755,43 @@ static void run(LV2_Handle instance, uint32_t sample_count) {
 	                  self->uris.csynth_bendrange, self->bendrange);
 	  self->send_bendrange_change_to_gui = false;
 	}
+	// if the crossfade time has changed, send it to the GUI
+	if (self->send_crossfade_change_to_gui) {
+	  lv2_atom_forge_frame_time(&self->forge, 0);
+	  write_set_float(&self->forge, &self->uris, 
+	                  self->uris.csynth_crossfade, self->crossfade_time);
+	  self->send_crossfade_change_to_gui = false;
+	}
+	// if the voice stealing policy has changed, send it to the GUI
+	if (self->send_stealing_change_to_gui) {
+	  lv2_atom_forge_frame_time(&self->forge, 0);
+	  write_set_int(&self->forge, &self->uris, 
+	                self->uris.csynth_stealing, self->voices.steal_policy);
+	  self->send_stealing_change_to_gui = false;
+	}
+	// if the load ceiling has changed, send it to the GUI
+	if (self->send_load_ceiling_change_to_gui) {
+	  lv2_atom_forge_frame_time(&self->forge, 0);
+	  write_set_float(&self->forge, &self->uris, 
+	                  self->uris.csynth_loadceiling, self->load_ceiling);
+	  self->send_load_ceiling_change_to_gui = false;
+	}
+	// if the governor has changed the number of voices, send it to the GUI
+	if (self->send_voice_limit_change_to_gui) {
+	  lv2_atom_forge_frame_time(&self->forge, 0);
+	  write_set_int(&self->forge, &self->uris, 
+	                self->uris.csynth_voicelimit, self->voices.voice_limit);
+	  self->send_voice_limit_change_to_gui = false;
+	}
+	// if a load report is due, send it to the GUI
+	if (self->send_load_stats_to_gui) {
+	  pack_load_stats(&self->load_stats, self->load_stats_array);
+	  lv2_atom_forge_frame_time(&self->forge, 0);
+	  write_set_float_array(&self->forge, &self->uris, 
+	                        self->uris.csynth_loadstats, self->load_stats_array,
+	                        LOAD_STAT_COUNT, self->load_stats_indices);
+	  self->send_load_stats_to_gui = false;
+	}
 	// if CV values have changed, send them to the GUI
 	if (self->send_cv_change_to_gui) {
 	  lv2_atom_forge_frame_time(&self->forge, 0);
@@ -377,14 +802,22 @@ static void run(LV2_Handle instance, uint32_t sample_count) {
 		self->set_cv_count = 0;
 	}
 	
+	// blocks too long to crossfade finish any fade in progress immediately
+	if (sample_count > CROSSFADE_BUFFER_LEN) retire_old_patch(self);
+	
 	// read incoming events and write audio
+	double event_time = 0.0;
+	double event_start;
 	LV2_ATOM_SEQUENCE_FOREACH(self->midi_in, ev) {
-	  uint32_t event_sample = ev->time.frames;
-	  if (event_sample > sample_count) event_sample = event_sample;
+	  uint32_t event_sample = schedule_event(self, ev, start_sample, 
+	                                         sample_count);
 	  // produce samples up to the time of this event
-	  write_samples(self, start_sample, event_sample);
-	  start_sample = event_sample;
+	  if (event_sample > start_sample) {
+	    write_samples(self, start_sample, event_sample);
+	    start_sample = event_sample;
+	  }
 	  // process events
+	  event_start = get_time();
 	  if (ev->body.type == self->uris.midi_Event) {
       const uint8_t* const msg = (const uint8_t*)(ev + 1);
       receive_midi_event(self, msg);
@@ -393,31 +826,84 @@ static void run(LV2_Handle instance, uint32_t sample_count) {
       const LV2_Atom_Object* obj = (const LV2_Atom_Object*)&ev->body;
       receive_atom_object(self, obj);
     }
+    event_time += get_time() - event_start;
 	}
 	// write any unwritten samples
 	write_samples(self, start_sample, sample_count);
+	// fade out the previous patch if it was just replaced
+	write_crossfade(self, sample_count);
+	// track voice levels for stealing
+	update_voice_levels(&self->voices, sample_count);
+	finish_fades(&self->voices);
+	// measure how long the block took relative to its duration
+	double elapsed = get_time() - start_time;
+	if (record_load(&self->load_stats, elapsed, 
+	                (double)sample_count * self->time_step, event_time,
+	                sounding_voice_count(&self->voices))) {
+	  self->send_load_stats_to_gui = true;
+	}
+	// adjust polyphony to keep processing within the realtime budget
+	govern_polyphony(self, elapsed, sample_count);
+	// periodically have the worker format a report from a profiled patch
+	if ((self->patch != NULL) && (self->patch->profile_report != NULL)) {
+	  self->profile_time += (double)sample_count * self->time_step;
+	  if (self->profile_time >= PROFILE_REPORT_INTERVAL) {
+	    PatchAtom msg = { 
+	        { sizeof(Patch *), self->uris.csynth_profilereport },
+	        self->patch
+	      };
+	    self->schedule->schedule_work(self->schedule->handle, sizeof(msg), &msg);
+	    self->profile_time = 0.0;
+	  }
+	}
 }
 
 // WORKER *********************************************************************
 
-static Patch *get_patch(Csynth *self, const char *path, int dispose_invalid) {
-  Patch *patch = build_patch(path, self->bundle_path, self->time_step);
+// return whether a build started by the worker has been superseded by a 
+//  newer request from the audio thread
+static int is_build_superseded(void *data) {
+  Csynth *self = (Csynth *)data;
+  return(__atomic_load_n(&self->builds_requested, __ATOMIC_ACQUIRE) > 
+         self->builds_started);
+}
+
+static Patch *get_patch(Csynth *self, const char *path, 
+                        BuildCancelledFunc is_cancelled) {
+  Patch *patch = build_patch(path, self->bundle_path, self->time_step, 
+                             self->profile, is_cancelled, self);
+  if ((patch != NULL) && (patch->cancelled)) return(patch);
   if ((! patch) || (! patch->built)) {
     warning("Failed to build patch");
   }
   else {
-    load_patch(patch);
+    load_patch(patch, get_voice_count(self));
     if (! patch->loaded) {
       warning("Failed to load patch");
-      if (dispose_invalid) {
-        dispose_patch(patch);
-        patch = NULL;
-      }
+    }
+    else {
+      warm_up_patch(patch);
     }
   }
   return(patch);
 }
 
+// store a description of how a build went and the files it depended on 
+//  to send to the GUI
+static void update_build_output(Csynth *self, const Patch *patch) {
+  memcpy(self->dependencies, patch->dependencies, sizeof(self->dependencies));
+  self->send_dependencies_to_gui = true;
+  const char *status;
+  if (patch->loaded) status = "Build okay";
+  else if (patch->built) status = "Build okay, but the patch failed to load";
+  else status = "Build failed";
+  // show compiler output followed by the status and how long it took
+  snprintf(self->build_output, sizeof(self->build_output), "%s%s%s after %.2f s%s.",
+           patch->output, (strlen(patch->output) > 0) ? "\n" : "", status, 
+           patch->build_time, patch->cached ? " (from cache)" : "");
+  self->send_build_output_to_gui = true;
+}
+
 static LV2_Worker_Status work(LV2_Handle instance,
                               LV2_Worker_Respond_Function respond,
                               LV2_Worker_Respond_Handle handle,
@@ -426,10 +912,32 @@ static LV2_Worker_Status work(LV2_Handle instance,
 	const LV2_Atom_Object *obj = (const LV2_Atom_Object *)data;
 	
 	// handle patch property sets
-	if (obj->body.otype == self->uris.csynth_disposeLib) {
+	if (obj->atom.type == self->uris.csynth_disposeLib) {
 	  const PatchAtom *msg = (const PatchAtom *)data;
 		dispose_patch(msg->patch);
 	}
+	// make more voices for a patch's context when polyphony increases, 
+	//  which the context keeps running without while they're made
+	else if (obj->atom.type == self->uris.csynth_resizeContext) {
+	  ContextAtom msg = *((const ContextAtom *)data);
+	  msg.voices = msg.patch->grow(msg.patch->context, msg.polyphony, 
+	                               PATCH_WARM_UP_SAMPLES);
+	  respond(handle, sizeof(msg), &msg);
+	}
+	// destroy voices that were made for a patch that's no longer in use
+	else if (obj->atom.type == self->uris.csynth_disposeVoices) {
+	  const ContextAtom *msg = (const ContextAtom *)data;
+	  msg->patch->release(msg->voices);
+	}
+	// format a profiling report outside the realtime audio thread
+	else if (obj->atom.type == self->uris.csynth_profilereport) {
+	  const PatchAtom *msg = (const PatchAtom *)data;
+	  ReportAtom report;
+	  int length = msg->patch->profile_report(report.text, PROFILE_REPORT_LEN);
+	  report.atom.type = self->uris.csynth_profilereport;
+	  report.atom.size = length + 1;
+	  respond(handle, sizeof(LV2_Atom) + report.atom.size, &report);
+	}
   else if (obj->body.otype == self->uris.patch_Set) {
     const uint32_t key = read_set_key(&self->uris, obj);
     const LV2_Atom *value = read_set_value(&self->uris, obj);
@@ -437,9 +945,22 @@ static LV2_Worker_Status work(LV2_Handle instance,
 		if (value != NULL) {
       // compile new code outside the realtime audio thread
       if (key == self->uris.csynth_codepath) {
+        self->builds_started++;
+        // skip builds that a newer request has already replaced
+        if (is_build_superseded(self)) return(LV2_WORKER_SUCCESS);
         const char *path = (const char *)LV2_ATOM_BODY_CONST(value);
-        Patch *patch = get_patch(self, path, true);
-        if (patch != NULL) respond(handle, sizeof(patch), &patch);
+        Patch *patch = get_patch(self, path, is_build_superseded);
+        // drop builds that were stopped partway through for the same reason
+        if ((patch != NULL) && (patch->cancelled)) {
+          dispose_patch(patch);
+        }
+        else if (patch != NULL) {
+          PatchAtom msg = { 
+              { sizeof(Patch *), self->uris.csynth_codepath },
+              patch
+            };
+          respond(handle, sizeof(msg), &msg);
+        }
       }
     }
   }
@@ -449,16 +970,58 @@ static LV2_Worker_Status work(LV2_Handle instance,
 static LV2_Worker_Status work_response(LV2_Handle instance,
                                        uint32_t size, const void *data) {
 	Csynth *self = (Csynth *)instance;
-	// semd a message to dispose the existing patch
+	const LV2_Atom *atom = (const LV2_Atom *)data;
+	// pass profiling reports on to the GUI
+	if (atom->type == self->uris.csynth_profilereport) {
+	  const ReportAtom *report = (const ReportAtom *)data;
+	  memcpy(self->profile_report, report->text, atom->size);
+	  self->send_profile_report_to_gui = true;
+	  return(LV2_WORKER_SUCCESS);
+	}
+	// add the new voices to the patch's context, leaving the voices that 
+	//  are already playing as they are, or have the worker destroy them if 
+	//  the patch was retired while they were being made
+	if (atom->type == self->uris.csynth_resizeContext) {
+	  ContextAtom msg = *((const ContextAtom *)data);
+	  Patch *patch = msg.patch;
+	  patch->resizing = 0;
+	  if ((msg.voices != NULL) && (! patch->retired)) {
+	    patch->attach(patch->context, msg.voices);
+	    patch->polyphony = msg.polyphony;
+	  }
+	  else if (msg.voices != NULL) {
+	    msg.atom.type = self->uris.csynth_disposeVoices;
+	    self->schedule->schedule_work(self->schedule->handle, sizeof(msg), &msg);
+	  }
+	  // dispose of the patch if it was retired while resizing, or keep up 
+	  //  with any further increases in polyphony
+	  if (patch->retired) dispose_patch_later(self, patch);
+	  else request_patch_resize(self, patch);
+	  return(LV2_WORKER_SUCCESS);
+	}
+	Patch *patch = ((const PatchAtom *)data)->patch;
+	update_build_output(self, patch);
+	// keep playing the existing patch if the new one didn't work
+	if (! patch->loaded) {
+	  dispose_patch_later(self, patch);
+	  return(LV2_WORKER_SUCCESS);
+	}
+	// only fade between two patches at a time
+	retire_old_patch(self);
+	// fade out the existing patch, or dispose of it right away if there's 
+	//  nothing to fade
 	if (self->patch != NULL) {
-	  PatchAtom msg = { 
-	      { sizeof(Patch *), self->uris.csynth_disposeLib },
-	      self->patch
-	    };
-	  self->schedule->schedule_work(self->schedule->handle, sizeof(msg), &msg);
-	}
-	// install the new patch
-	self->patch = *(Patch * const *)data;
+	  self->old_patch = self->patch;
+	  self->crossfade = 0.0;
+	  if ((! self->old_patch->loaded) || (! (self->crossfade_time > 0.0))) {
+	    retire_old_patch(self);
+	  }
+	}
+	// install the new patch, making sure it has enough voices in case 
+	//  polyphony changed while it was building
+	self->patch = patch;
+	self->profile_time = 0.0;
+	request_patch_resize(self, patch);
 	return(LV2_WORKER_SUCCESS);
 }
 
@@ -491,12 +1054,25 @@ static LV2_State_Status save(LV2_Handle instance, LV2_State_Store_Function store
 	// store autobuild settings
 	store(handle, self->uris.csynth_autobuild, &self->autobuild, sizeof(int),
 	      self->uris.atom_Int, LV2_STATE_IS_POD | LV2_STATE_IS_PORTABLE);
+	// store profiling settings
+	store(handle, self->uris.csynth_profile, &self->profile, sizeof(int),
+	      self->uris.atom_Int, LV2_STATE_IS_POD | LV2_STATE_IS_PORTABLE);
 	// store polyphony settings
 	store(handle, self->uris.csynth_polyphony, &self->polyphony, sizeof(int),
 	      self->uris.atom_Int, LV2_STATE_IS_POD | LV2_STATE_IS_PORTABLE);
 	// store bend range settings
 	store(handle, self->uris.csynth_bendrange, &self->bendrange, sizeof(float),
 	      self->uris.atom_Float, LV2_STATE_IS_POD | LV2_STATE_IS_PORTABLE);
+	// store voice stealing settings
+	int stealing = self->voices.steal_policy;
+	store(handle, self->uris.csynth_stealing, &stealing, sizeof(int),
+	      self->uris.atom_Int, LV2_STATE_IS_POD | LV2_STATE_IS_PORTABLE);
+	// store crossfade settings
+	store(handle, self->uris.csynth_crossfade, &self->crossfade_time, sizeof(float),
+	      self->uris.atom_Float, LV2_STATE_IS_POD | LV2_STATE_IS_PORTABLE);
+	// store load ceiling settings
+	store(handle, self->uris.csynth_loadceiling, &self->load_ceiling, sizeof(float),
+	      self->uris.atom_Float, LV2_STATE_IS_POD | LV2_STATE_IS_PORTABLE);
 	// store controller values
 	uint8_t buffer[2048];
   lv2_atom_forge_set_buffer(&self->forge, buffer, 2048);
@@ -529,13 +1105,30 @@ static LV2_State_Status restore(LV2_Handle instance,
 	size_t size;
 	uint32_t type, valflags;
 
+	// retrieve profiling settings before building the patch they apply to
+	const void *value = retrieve(handle, self->uris.csynth_profile, 
+	                             &size, &type, &valflags);
+	if (value) {
+	  self->profile = *((int *)value);
+	  self->send_profile_change_to_gui = true;
+	}
+	// retrieve polyphony settings before building the patch, so it has 
+	//  enough voices
+	value = retrieve(handle, self->uris.csynth_polyphony, &size, &type, &valflags);
+	if (value) {
+	  update_polyphony(self, *((int *)value));
+	  self->send_polyphony_change_to_gui = true;
+	}
   // retrieve the code path
-	const void *value = retrieve(handle, self->uris.csynth_codepath,
-		                           &size, &type, &valflags);
+	value = retrieve(handle, self->uris.csynth_codepath,
+		               &size, &type, &valflags);
 	if (value) {
 		const char *path = (const char *)value;
-		Patch *patch = get_patch(self, path, false);
+		Patch *patch = get_patch(self, path, NULL);
 		if (patch != NULL) {
+		  update_build_output(self, patch);
+		  dispose_patch(self->old_patch);
+		  self->old_patch = NULL;
 		  dispose_patch(self->patch);
 		  self->patch = patch;
 		  self->send_patch_change_to_gui = true;
@@ -547,23 +1140,36 @@ static LV2_State_Status restore(LV2_Handle instance,
 	  self->autobuild = *((int *)value);
 	  self->send_autobuild_change_to_gui = true;
 	}
-	// retrieve polyphony settings
-	value = retrieve(handle, self->uris.csynth_polyphony, &size, &type, &valflags);
-	if (value) {
-	  self->polyphony = *((int *)value);
-	  self->send_polyphony_change_to_gui = true;
-	}
 	// retrieve bend range settings
 	value = retrieve(handle, self->uris.csynth_bendrange, &size, &type, &valflags);
 	if (value) {
 	  update_bend(self, self->bend, *((float *)value));
 	  self->send_bendrange_change_to_gui = true;
 	}
+	// retrieve voice stealing settings
+	value = retrieve(handle, self->uris.csynth_stealing, &size, &type, &valflags);
+	if (value) {
+	  update_stealing(self, *((int *)value));
+	  self->send_stealing_change_to_gui = true;
+	}
+	// retrieve crossfade settings
+	value = retrieve(handle, self->uris.csynth_crossfade, &size, &type, &valflags);
+	if (value) {
+	  update_crossfade_time(self, *((float *)value));
+	  self->send_crossfade_change_to_gui = true;
+	}
+	// retrieve load ceiling settings
+	value = retrieve(handle, self->uris.csynth_loadceiling, &size, &type, &valflags);
+	if (value) {
+	  update_load_ceiling(self, *((float *)value));
+	  self->send_load_ceiling_change_to_gui = true;
+	}
 	// retrieve controller values
 	value = retrieve(handle, self->uris.csynth_cv, &size, &type, &valflags);
 	if (value) {
 	  const LV2_Atom_Tuple *tuple = (const LV2_Atom_Tuple *)value;
 	  read_set_float_array(&self->uris, tuple, CV_COUNT, self->cv);
+	  jump_all_cv(&self->cv_ramps, self->cv);
 	  for (i = 0; i < CV_COUNT; i++) {
 	    self->set_cv_indices[i] = i;
 	  }
@@ -5,10 +5,11 @@
 #include <gtk/gtk.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/inotify.h>
 
 #include "csynth.h"
 #include "uris.h"
-#include "patch.h"
+#include "stats.h"
 
 #include "lv2/lv2plug.in/ns/lv2core/lv2.h"
 #include "lv2/lv2plug.in/ns/ext/atom/atom.h"
@@ -18,6 +19,12 @@
 #include "lv2/lv2plug.in/ns/ext/urid/urid.h"
 #include "lv2/lv2plug.in/ns/extensions/ui/ui.h"
 
+// the maximum number of directories to watch for changes to the patch code
+#define MAX_WATCH_COUNT 64
+// the time in milliseconds to wait after a change before building, so that
+//  a burst of saves only causes one build
+#define AUTOBUILD_DEBOUNCE_TIME 50
+
 typedef struct {
   // the GTK container with the GUI controls
   GtkWidget *widget;
@@ -27,12 +34,27 @@ typedef struct {
   GtkWidget *chooser;
   // the toggle that turns automatic building on and off
   GtkWidget *autobuild_toggle;
+  // the toggle that turns profiling builds on and off
+  GtkWidget *profile_toggle;
   // the slider that controls the number of voices
   GtkWidget *polyphony_scale;
+  // the selector for the voice stealing policy
+  GtkWidget *stealing_combo;
+  // the slider that controls the fraction of the realtime budget to use
+  GtkWidget *loadceiling_scale;
+  // the label showing how many voices the load governor allows
+  GtkWidget *voicelimit_label;
   // the slider that controls the range of pitch bends
   GtkWidget *bendrange_scale;
+  GtkWidget *crossfade_scale;
   // the buffer showing compiler output
   GtkTextBuffer *buffer;
+  // the most recent compiler output and profiling report, which are shown 
+  //  together in the buffer
+  gchar *build_output;
+  gchar *profile_report;
+  // the label summarizing processing load
+  GtkWidget *load_label;
   // LV2 features
   LV2_URID_Map *map;
   CsynthURIs uris;
@@ -51,10 +73,25 @@ typedef struct {
   // state
   float cv[CV_COUNT];
   gboolean autobuild;
-  guint autobuild_timer;
-  time_t last_modified_time; // the last time the code was modified
+  gboolean profile;
+  // the files the patch was last built from, separated by newlines
+  gchar *dependencies;
+  // an inotify instance watching the directories containing those files
+  int inotify_fd;
+  GIOChannel *inotify_channel;
+  guint inotify_source;
+  int watches[MAX_WATCH_COUNT];
+  gchar *watch_dirs[MAX_WATCH_COUNT];
+  int watch_count;
+  // a timer that delays builds until changes stop
+  guint debounce_timer;
   int polyphony;
+  int stealing;
+  float loadceiling;
+  int voicelimit;
   float bendrange;
+  float crossfade;
+  float load_stats[LOAD_STAT_COUNT];
 } CsynthGUI;
 
 // send a patch to the plugin
@@ -69,50 +106,125 @@ void send_code_path(CsynthGUI *self) {
   self->write_function(self->controller, 0, lv2_atom_total_size(msg),
                        self->uris.atom_eventTransfer, msg);
 }
-// build the current code
+// show the compiler output with the latest profiling report below it, so 
+//  errors from a failed rebuild stay visible while profiling
+void show_output(CsynthGUI *self) {
+  gchar *text = g_strconcat(
+    (self->build_output != NULL) ? self->build_output : "",
+    ((self->build_output != NULL) && (self->profile_report != NULL)) ? 
+      "\n\n" : "",
+    (self->profile_report != NULL) ? self->profile_report : "", NULL);
+  gtk_text_buffer_set_text(self->buffer, text, -1);
+  g_free(text);
+}
+// have the plugin build the current code, which will send back the output
 void start_build(CsynthGUI *self) {
-  Patch *patch = build_patch(self->code_path, self->bundle_path, 1.0 / 48000.0);
-  // see if the build worked
-  if (patch != NULL) {
-    // show build output
-    if ((patch->output == NULL) || (strlen(patch->output) == 0)) {
-      if (patch->built) gtk_text_buffer_set_text(self->buffer, "Build okay.", -1);
-      else gtk_text_buffer_set_text(self->buffer, "Build failed.", -1);
-    }
-    else {
-      gtk_text_buffer_set_text(self->buffer, patch->output, -1);
+  if (self->code_path == NULL) return;
+  gtk_text_buffer_set_text(self->buffer, "Building...", -1);
+  send_code_path(self);
+}
+// build once changes have stopped coming in
+gboolean on_debounce_timer(gpointer data) {
+  CsynthGUI *self = (CsynthGUI *)data;
+  self->debounce_timer = 0;
+  start_build(self);
+  return(FALSE);
+}
+// return whether the given path is one the patch was built from
+gboolean is_dependency(CsynthGUI *self, const char *path) {
+  if ((self->code_path != NULL) && (strcmp(path, self->code_path) == 0)) {
+    return(TRUE);
+  }
+  if (self->dependencies == NULL) return(FALSE);
+  gboolean found = FALSE;
+  gchar **paths = g_strsplit(self->dependencies, "\n", -1);
+  for (int i = 0; paths[i] != NULL; i++) {
+    if (strcmp(path, paths[i]) == 0) {
+      found = TRUE;
+      break;
     }
-    // tell the plugin to rebuild the patch
-    send_code_path(self);
-    // discard the patch we were using to test the build
-    dispose_patch(patch);
   }
+  g_strfreev(paths);
+  return(found);
 }
-// react to the text changing
-gboolean on_autobuild_timer(gpointer data) {
+// react to files changing in watched directories
+gboolean on_inotify(GIOChannel *channel, GIOCondition condition, gpointer data) {
   CsynthGUI *self = (CsynthGUI *)data;
-  if (self->code_path != NULL) {
-    struct stat stat_buf;
-    stat(self->code_path, &stat_buf);
-    if (stat_buf.st_mtime != self->last_modified_time) {
-      self->last_modified_time = stat_buf.st_mtime;
-      start_build(self);
+  char buffer[4096] 
+    __attribute__ ((aligned(__alignof__(struct inotify_event))));
+  const struct inotify_event *event;
+  ssize_t length;
+  int i;
+  while ((length = read(self->inotify_fd, buffer, sizeof(buffer))) > 0) {
+    for (char *p = buffer; p < buffer + length; 
+         p += sizeof(struct inotify_event) + event->len) {
+      event = (const struct inotify_event *)p;
+      if (event->len == 0) continue;
+      for (i = 0; i < self->watch_count; i++) {
+        if (self->watches[i] != event->wd) continue;
+        gchar *path = g_build_filename(self->watch_dirs[i], event->name, NULL);
+        // restart the delay on every change so bursts coalesce
+        if (is_dependency(self, path)) {
+          if (self->debounce_timer != 0) g_source_remove(self->debounce_timer);
+          self->debounce_timer = g_timeout_add(
+            AUTOBUILD_DEBOUNCE_TIME, on_debounce_timer, self);
+        }
+        g_free(path);
+        break;
+      }
     }
   }
   return(TRUE);
 }
+// stop watching all directories
+void clear_watches(CsynthGUI *self) {
+  for (int i = 0; i < self->watch_count; i++) {
+    inotify_rm_watch(self->inotify_fd, self->watches[i]);
+    g_free(self->watch_dirs[i]);
+  }
+  self->watch_count = 0;
+}
+// watch the directory containing a file, if it isn't already watched
+void watch_file(CsynthGUI *self, const char *path) {
+  if ((path == NULL) || (strlen(path) == 0)) return;
+  if (self->watch_count >= MAX_WATCH_COUNT) return;
+  gchar *dir = g_path_get_dirname(path);
+  for (int i = 0; i < self->watch_count; i++) {
+    if (strcmp(dir, self->watch_dirs[i]) == 0) {
+      g_free(dir);
+      return;
+    }
+  }
+  // watch for writes and for editors that save by replacing the file
+  int wd = inotify_add_watch(self->inotify_fd, dir, 
+    IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+  if (wd < 0) {
+    warning("Failed to watch a directory for changes");
+    g_free(dir);
+    return;
+  }
+  self->watches[self->watch_count] = wd;
+  self->watch_dirs[self->watch_count] = dir;
+  self->watch_count++;
+}
 void update_autobuild(CsynthGUI *self) {
-  // if autobuild is on, build when the code changes
+  if (self->inotify_fd < 0) return;
+  clear_watches(self);
+  // if autobuild is on, build when the code or anything it includes changes
   if ((self->autobuild) && (self->code_path != NULL)) {
-    // make a timer to check if the file is modified
-    if (self->autobuild_timer == 0) {
-      self->autobuild_timer = g_timeout_add_seconds(1, on_autobuild_timer, self);
+    watch_file(self, self->code_path);
+    if (self->dependencies != NULL) {
+      gchar **paths = g_strsplit(self->dependencies, "\n", -1);
+      for (int i = 0; paths[i] != NULL; i++) {
+        watch_file(self, paths[i]);
+      }
+      g_strfreev(paths);
     }
   }
-  // disable the timer when autobuild is turned off
-  else if (self->autobuild_timer != 0) {
-    g_source_remove(self->autobuild_timer);
-    self->autobuild_timer = 0;
+  // cancel any pending build when autobuild is turned off
+  else if (self->debounce_timer != 0) {
+    g_source_remove(self->debounce_timer);
+    self->debounce_timer = 0;
   }
 }
 // react to button clicks
@@ -128,6 +240,19 @@ void on_autobuild(GtkCheckButton *button, CsynthGUI *self) {
   self->write_function(self->controller, 0, lv2_atom_total_size(msg),
                        self->uris.atom_eventTransfer, msg);
 }
+void on_profile(GtkCheckButton *button, CsynthGUI *self) {
+  if (self->receiving_from_plugin) return;
+  self->profile = gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(button));
+  // send the profile setting to the plugin
+  uint8_t obj_buf[64];
+  lv2_atom_forge_set_buffer(&self->forge, obj_buf, 64);
+  LV2_Atom* msg = write_set_int(&self->forge, &self->uris,
+                    self->uris.csynth_profile, self->profile);
+  self->write_function(self->controller, 0, lv2_atom_total_size(msg),
+                       self->uris.atom_eventTransfer, msg);
+  // rebuild so the setting takes effect
+  if (self->code_path != NULL) start_build(self);
+}
 void on_polyphony(GtkWidget *scale, CsynthGUI *self) {
   if (self->receiving_from_plugin) return;
   self->polyphony = gtk_range_get_value(GTK_RANGE(scale));
@@ -138,6 +263,67 @@ void on_polyphony(GtkWidget *scale, CsynthGUI *self) {
   self->write_function(self->controller, 0, lv2_atom_total_size(msg),
                        self->uris.atom_eventTransfer, msg);
 }
+void on_stealing(GtkWidget *combo, CsynthGUI *self) {
+  if (self->receiving_from_plugin) return;
+  self->stealing = gtk_combo_box_get_active(GTK_COMBO_BOX(combo));
+  uint8_t obj_buf[1024];
+  lv2_atom_forge_set_buffer(&self->forge, obj_buf, 1024);
+  LV2_Atom* msg = write_set_int(&self->forge, &self->uris,
+                                self->uris.csynth_stealing, self->stealing);
+  self->write_function(self->controller, 0, lv2_atom_total_size(msg),
+                       self->uris.atom_eventTransfer, msg);
+}
+void on_loadceiling(GtkWidget *scale, CsynthGUI *self) {
+  if (self->receiving_from_plugin) return;
+  self->loadceiling = gtk_range_get_value(GTK_RANGE(scale));
+  uint8_t obj_buf[1024];
+  lv2_atom_forge_set_buffer(&self->forge, obj_buf, 1024);
+  LV2_Atom* msg = write_set_float(&self->forge, &self->uris,
+                                  self->uris.csynth_loadceiling, self->loadceiling);
+  self->write_function(self->controller, 0, lv2_atom_total_size(msg),
+                       self->uris.atom_eventTransfer, msg);
+}
+// show the number of voices the plugin is currently allowing
+void update_voicelimit(CsynthGUI *self) {
+  char text[64];
+  snprintf(text, sizeof(text), "Effective voices: %i", self->voicelimit);
+  gtk_label_set_text(GTK_LABEL(self->voicelimit_label), text);
+}
+// summarize the latest load statistics from the plugin
+void update_load_label(CsynthGUI *self) {
+  char text[128];
+  const float *stats = self->load_stats;
+  snprintf(text, sizeof(text), 
+    "Load %.0f%% (p99 %.0f%%, worst %.0f%%), %.0f xruns, %.0f voices",
+    stats[LOAD_RECENT] * 100.0, load_percentile(stats, 0.99) * 100.0,
+    stats[LOAD_WORST] * 100.0, stats[LOAD_XRUNS], stats[LOAD_VOICES]);
+  gtk_label_set_text(GTK_LABEL(self->load_label), text);
+}
+// save the latest load statistics as a JSON file
+void on_report(GtkButton *button, CsynthGUI *self) {
+  GtkWidget *dialog = gtk_file_chooser_dialog_new("Save Load Report",
+    GTK_WINDOW(gtk_widget_get_toplevel(self->widget)),
+    GTK_FILE_CHOOSER_ACTION_SAVE,
+    GTK_STOCK_CANCEL, GTK_RESPONSE_CANCEL,
+    GTK_STOCK_SAVE, GTK_RESPONSE_ACCEPT, NULL);
+  gtk_file_chooser_set_do_overwrite_confirmation(
+    GTK_FILE_CHOOSER(dialog), TRUE);
+  gtk_file_chooser_set_current_name(
+    GTK_FILE_CHOOSER(dialog), "csynth-load.json");
+  if (gtk_dialog_run(GTK_DIALOG(dialog)) == GTK_RESPONSE_ACCEPT) {
+    gchar *path = gtk_file_chooser_get_filename(GTK_FILE_CHOOSER(dialog));
+    FILE *f = fopen(path, "w");
+    if (f == NULL) {
+      warning("Failed to open load report file for writing");
+    }
+    else {
+      write_load_report(f, self->load_stats);
+      fclose(f);
+    }
+    g_free(path);
+  }
+  gtk_widget_destroy(dialog);
+}
 void on_bendrange(GtkWidget *scale, CsynthGUI *self) {
   if (self->receiving_from_plugin) return;
   self->bendrange = gtk_range_get_value(GTK_RANGE(scale));
@@ -148,6 +334,16 @@ void on_bendrange(GtkWidget *scale, CsynthGUI *self) {
   self->write_function(self->controller, 0, lv2_atom_total_size(msg),
                        self->uris.atom_eventTransfer, msg);
 }
+void on_crossfade(GtkWidget *scale, CsynthGUI *self) {
+  if (self->receiving_from_plugin) return;
+  self->crossfade = gtk_range_get_value(GTK_RANGE(scale));
+  uint8_t obj_buf[1024];
+  lv2_atom_forge_set_buffer(&self->forge, obj_buf, 1024);
+  LV2_Atom* msg = write_set_float(&self->forge, &self->uris,
+                                  self->uris.csynth_crossfade, self->crossfade);
+  self->write_function(self->controller, 0, lv2_atom_total_size(msg),
+                       self->uris.atom_eventTransfer, msg);
+}
 void get_code_path(CsynthGUI *self) {
   if (self->code_path != NULL) g_free(self->code_path);
   self->code_path = gtk_file_chooser_get_filename(
@@ -160,14 +356,11 @@ void on_build(GtkButton *button, CsynthGUI *self) {
 void on_file_set(GtkFileChooserButton *button, CsynthGUI *self) {
   if (self->receiving_from_plugin) return;
   get_code_path(self);
-  self->last_modified_time = 0;
+  // forget the dependencies of the old code until the new code is built
+  g_free(self->dependencies);
+  self->dependencies = NULL;
   update_autobuild(self);
-  if (self->autobuild) {
-    on_autobuild_timer(self);
-  }
-  else {
-    start_build(self);
-  }
+  start_build(self);
 }
 void on_cv_changed(GtkWidget *scale, CsynthGUI *self) {
   if (self->receiving_from_plugin) return;
@@ -215,16 +408,47 @@ static GtkWidget *make_gui(CsynthGUI *self) {
   GtkWidget *polyphony_header = section_header_new("<b>Polyphony (number of voices)</b>");
   GtkWidget *polyphony = scale_section_new(&self->polyphony_scale, 
     1.0, (float)MAX_VOICE_COUNT, 1.0);
+  // make a section for the voice stealing policy
+  GtkWidget *stealing_header = section_header_new("<b>Voice Stealing</b>");
+  self->stealing_combo = gtk_combo_box_new_text();
+  gtk_combo_box_append_text(GTK_COMBO_BOX(self->stealing_combo), "Oldest");
+  gtk_combo_box_append_text(GTK_COMBO_BOX(self->stealing_combo), "Quietest");
+  gtk_combo_box_append_text(GTK_COMBO_BOX(self->stealing_combo), "Same note");
+  gtk_combo_box_set_active(GTK_COMBO_BOX(self->stealing_combo), 0);
+  GtkWidget *stealing = gtk_alignment_new(0.0, 0.0, 0.0, 1.0);
+  gtk_alignment_set_padding(GTK_ALIGNMENT(stealing), 0.0, 0.0, 5.0, 5.0);
+  gtk_container_add(GTK_CONTAINER(stealing), self->stealing_combo);
+  // make a section for the load governor
+  GtkWidget *loadceiling_header = section_header_new("<b>Load Ceiling (fraction of realtime)</b>");
+  GtkWidget *loadceiling = scale_section_new(&self->loadceiling_scale, 
+    0.1, 1.0, 0.05);
+  gtk_range_set_value(GTK_RANGE(self->loadceiling_scale), 0.8);
+  self->voicelimit_label = gtk_label_new(NULL);
+  gtk_misc_set_alignment(GTK_MISC(self->voicelimit_label), 0.0, 0.5);
+  gtk_misc_set_padding(GTK_MISC(self->voicelimit_label), 5, 0);
+  update_voicelimit(self);
   // make a section for bend range controls
   GtkWidget *bendrange_header = section_header_new("<b>Pitch Bend Range (semitones)</b>");
   GtkWidget *bendrange = scale_section_new(&self->bendrange_scale, 
     0.0, 24.0, 1.0);
+  // make a section for the time to fade between patches
+  GtkWidget *crossfade_header = section_header_new("<b>Patch Crossfade (seconds)</b>");
+  GtkWidget *crossfade = scale_section_new(&self->crossfade_scale, 
+    0.0, 1.0, 0.01);
+  gtk_range_set_value(GTK_RANGE(self->crossfade_scale), 0.05);
   // package range controls
   GtkWidget *range_section = gtk_vbox_new(FALSE, 0);
   gtk_box_pack_start(GTK_BOX(range_section), polyphony_header, FALSE, FALSE, 0);
   gtk_box_pack_start(GTK_BOX(range_section), polyphony, FALSE, FALSE, s);
+  gtk_box_pack_start(GTK_BOX(range_section), stealing_header, FALSE, FALSE, 0);
+  gtk_box_pack_start(GTK_BOX(range_section), stealing, FALSE, FALSE, s);
+  gtk_box_pack_start(GTK_BOX(range_section), loadceiling_header, FALSE, FALSE, 0);
+  gtk_box_pack_start(GTK_BOX(range_section), loadceiling, FALSE, FALSE, s);
+  gtk_box_pack_start(GTK_BOX(range_section), self->voicelimit_label, FALSE, FALSE, 0);
   gtk_box_pack_start(GTK_BOX(range_section), bendrange_header, FALSE, FALSE, 0);
   gtk_box_pack_start(GTK_BOX(range_section), bendrange, FALSE, FALSE, s);
+  gtk_box_pack_start(GTK_BOX(range_section), crossfade_header, FALSE, FALSE, 0);
+  gtk_box_pack_start(GTK_BOX(range_section), crossfade, FALSE, FALSE, s);
   // make a heading for the CV inputs
   GtkWidget *cv_header = section_header_new("<b>Controller Values</b>");
   // make a section for CV inputs
@@ -280,9 +504,17 @@ static GtkWidget *make_gui(CsynthGUI *self) {
   // make a button section
   GtkWidget *build_button = gtk_button_new_with_label("Build");
   self->autobuild_toggle = gtk_check_button_new_with_label("Autobuild");
+  self->profile_toggle = gtk_check_button_new_with_label("Profile");
   GtkWidget *build_bar = gtk_hbox_new(FALSE, s);
+  self->load_label = gtk_label_new(NULL);
+  gtk_misc_set_alignment(GTK_MISC(self->load_label), 0.0, 0.5);
+  update_load_label(self);
+  GtkWidget *report_button = gtk_button_new_with_label("Report");
+  gtk_box_pack_start(GTK_BOX(build_bar), self->load_label, TRUE, TRUE, s);
+  gtk_box_pack_start(GTK_BOX(build_bar), report_button, FALSE, FALSE, 0);
   gtk_box_pack_end(GTK_BOX(build_bar), build_button, FALSE, FALSE, s);
   gtk_box_pack_end(GTK_BOX(build_bar), self->autobuild_toggle, FALSE, FALSE, s);
+  gtk_box_pack_end(GTK_BOX(build_bar), self->profile_toggle, FALSE, FALSE, s);
   // package all the patch source controls
   GtkWidget *source_section = gtk_vbox_new(FALSE, 0);
   gtk_box_pack_start(GTK_BOX(source_section), source_header, FALSE, FALSE, 0);
@@ -292,9 +524,14 @@ static GtkWidget *make_gui(CsynthGUI *self) {
   // wire events
   g_signal_connect(self->chooser, "file-set", G_CALLBACK(on_file_set), self);
   g_signal_connect(build_button, "clicked", G_CALLBACK(on_build), self);
+  g_signal_connect(report_button, "clicked", G_CALLBACK(on_report), self);
   g_signal_connect(self->autobuild_toggle, "toggled", G_CALLBACK(on_autobuild), self);
+  g_signal_connect(self->profile_toggle, "toggled", G_CALLBACK(on_profile), self);
   g_signal_connect(self->polyphony_scale, "value-changed", G_CALLBACK(on_polyphony), self);
+  g_signal_connect(self->stealing_combo, "changed", G_CALLBACK(on_stealing), self);
+  g_signal_connect(self->loadceiling_scale, "value-changed", G_CALLBACK(on_loadceiling), self);
   g_signal_connect(self->bendrange_scale, "value-changed", G_CALLBACK(on_bendrange), self);
+  g_signal_connect(self->crossfade_scale, "value-changed", G_CALLBACK(on_crossfade), self);
   // pack sections vertically and return the root widget
   GtkWidget *container = gtk_vbox_new(FALSE, s);
   gtk_box_pack_start(GTK_BOX(container), range_section, FALSE, FALSE, s);
@@ -342,6 +579,29 @@ static LV2UI_Handle instantiate(const struct _LV2UI_Descriptor *descriptor,
     sprintf(presets_path, "%s/presets", bundle_path);
     self->presets_path = (const char *)presets_path;
   }
+  // clear state reported by the plugin
+  self->voicelimit = 0;
+  self->profile = FALSE;
+  self->code_path = NULL;
+  self->autobuild = FALSE;
+  // set up to watch for changes to the code
+  self->dependencies = NULL;
+  self->build_output = NULL;
+  self->profile_report = NULL;
+  self->watch_count = 0;
+  self->debounce_timer = 0;
+  self->inotify_channel = NULL;
+  self->inotify_source = 0;
+  self->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (self->inotify_fd < 0) {
+    warning("Failed to set up inotify, so autobuild won't work");
+  }
+  else {
+    self->inotify_channel = g_io_channel_unix_new(self->inotify_fd);
+    self->inotify_source = g_io_add_watch(self->inotify_channel, G_IO_IN, 
+                                          on_inotify, self);
+  }
+  memset(self->load_stats, 0, sizeof(self->load_stats));
   // build the GUI
   self->widget = make_gui(self);
   *widget = (LV2UI_Widget)self->widget;
@@ -360,6 +620,17 @@ static LV2UI_Handle instantiate(const struct _LV2UI_Descriptor *descriptor,
 
 static void cleanup(LV2UI_Handle ui) {
   CsynthGUI *self = (CsynthGUI *)ui;
+  if (self->debounce_timer != 0) g_source_remove(self->debounce_timer);
+  if (self->inotify_fd >= 0) {
+    clear_watches(self);
+    g_source_remove(self->inotify_source);
+    g_io_channel_unref(self->inotify_channel);
+    close(self->inotify_fd);
+  }
+  g_free(self->dependencies);
+  g_free(self->build_output);
+  g_free(self->profile_report);
+  g_free(self->code_path);
   free(self);
 }
 
@@ -386,7 +657,9 @@ static void port_event(LV2UI_Handle ui, uint32_t port_index,
 			  }
 			  else {
 			    gtk_file_chooser_set_filename(GTK_FILE_CHOOSER(self->chooser), path);
-			    on_file_set(GTK_FILE_CHOOSER_BUTTON(self->chooser), self);
+			    g_free(self->code_path);
+			    self->code_path = g_strdup(path);
+			    update_autobuild(self);
 			  }
 			}
 			// read the autobuild setting
@@ -396,11 +669,68 @@ static void port_event(LV2UI_Handle ui, uint32_t port_index,
 			    GTK_TOGGLE_BUTTON(self->autobuild_toggle), self->autobuild);
 			  update_autobuild(self);
 			}
+			// read the profiling setting
+			else if (key == self->uris.csynth_profile) {
+			  self->profile = *((int *)LV2_ATOM_BODY(value));
+			  gtk_toggle_button_set_active(
+			    GTK_TOGGLE_BUTTON(self->profile_toggle), self->profile);
+			}
+			// watch the files the patch was built from
+			else if (key == self->uris.csynth_dependencies) {
+			  const char *dependencies = (const char *)LV2_ATOM_BODY_CONST(value);
+			  g_free(self->dependencies);
+			  self->dependencies = g_strdup(dependencies);
+			  update_autobuild(self);
+			}
+			// show compiler output from the plugin's build
+			else if (key == self->uris.csynth_buildoutput) {
+			  const char *output = (const char *)LV2_ATOM_BODY_CONST(value);
+			  g_free(self->build_output);
+			  self->build_output = g_strdup(output);
+			  // reports from the previous build no longer apply
+			  g_free(self->profile_report);
+			  self->profile_report = NULL;
+			  show_output(self);
+			}
+			// show profiling reports below the compiler output
+			else if (key == self->uris.csynth_profilereport) {
+			  const char *report = (const char *)LV2_ATOM_BODY_CONST(value);
+			  g_free(self->profile_report);
+			  self->profile_report = g_strdup(report);
+			  show_output(self);
+			}
 			// read the polyphony setting
 			else if (key == self->uris.csynth_polyphony) {
 			  self->polyphony = *((int *)LV2_ATOM_BODY(value));
 			  gtk_range_set_value(GTK_RANGE(self->polyphony_scale), self->polyphony);
 			}
+			// read the voice stealing setting
+			else if (key == self->uris.csynth_stealing) {
+			  self->stealing = *((int *)LV2_ATOM_BODY(value));
+			  gtk_combo_box_set_active(GTK_COMBO_BOX(self->stealing_combo), self->stealing);
+			}
+			// read the load ceiling setting
+			else if (key == self->uris.csynth_loadceiling) {
+			  self->loadceiling = *((float *)LV2_ATOM_BODY(value));
+			  gtk_range_set_value(GTK_RANGE(self->loadceiling_scale), self->loadceiling);
+			}
+			// read the number of voices the load governor allows
+			else if (key == self->uris.csynth_voicelimit) {
+			  self->voicelimit = *((int *)LV2_ATOM_BODY(value));
+			  update_voicelimit(self);
+			}
+			// read load statistics
+			else if (key == self->uris.csynth_loadstats) {
+			  const LV2_Atom_Tuple *tuple = (const LV2_Atom_Tuple *)value;
+			  read_set_float_array(&self->uris, tuple, 
+			                       LOAD_STAT_COUNT, self->load_stats);
+			  update_load_label(self);
+			}
+			// read the crossfade setting
+			else if (key == self->uris.csynth_crossfade) {
+			  self->crossfade = *((float *)LV2_ATOM_BODY(value));
+			  gtk_range_set_value(GTK_RANGE(self->crossfade_scale), self->crossfade);
+			}
 			// read the bendrange setting
 			else if (key == self->uris.csynth_bendrange) {
 			  self->bendrange = *((float *)LV2_ATOM_BODY(value));
@@ -0,0 +1,102 @@
+#ifndef CSYNTH_CV_H
+#define CSYNTH_CV_H
+
+#include <string.h>
+
+#include "csynth.h"
+
+// the time in seconds for a controller to ramp to a new value
+#define CV_SMOOTH_TIME 0.005
+// the number of samples of controller values to fill in at a time, which 
+//  is also the most samples shared modulators are evaluated for at once
+//  and can't be more than MODULATOR_BLOCK_LEN in lib/modulators.h
+#define CV_FRAME_COUNT 64
+
+// smoothed controller values, where changes ramp linearly from the
+//  current value to the new one so patches don't hear sudden steps
+typedef struct {
+  // the value each controller is ramping toward
+  float target[CV_COUNT];
+  // the current value of each controller
+  float value[CV_COUNT];
+  // the change per sample and remaining samples of each ramp
+  float delta[CV_COUNT];
+  int remaining[CV_COUNT];
+  // the controllers currently ramping
+  int ramping[CV_COUNT];
+  int ramping_count;
+  // the number of samples a ramp takes
+  int ramp_samples;
+  // whether every frame already holds the current values
+  int steady;
+  // controller values for each sample of the current frame, where the
+  //  values for sample i start at frames[i]
+  float frames[CV_FRAME_COUNT][CV_COUNT];
+} CVRamps;
+
+static inline void init_cv_ramps(CVRamps *cv, double time_step) {
+  memset(cv, 0, sizeof(CVRamps));
+  cv->ramp_samples = (int)(CV_SMOOTH_TIME / time_step);
+  if (cv->ramp_samples < 1) cv->ramp_samples = 1;
+}
+
+// start ramping a controller to a new value
+static inline void set_cv(CVRamps *cv, int index, float value) {
+  if ((index < 0) || (index >= CV_COUNT)) return;
+  cv->target[index] = value;
+  cv->steady = 0;
+  if (cv->remaining[index] <= 0) {
+    if (value == cv->value[index]) return;
+    cv->ramping[cv->ramping_count++] = index;
+  }
+  cv->delta[index] = (value - cv->value[index]) / (float)cv->ramp_samples;
+  cv->remaining[index] = cv->ramp_samples;
+}
+
+// start ramping all controllers to the values in an array
+static inline void set_all_cv(CVRamps *cv, const float *values) {
+  for (int i = 0; i < CV_COUNT; i++) {
+    if (values[i] != cv->target[i]) set_cv(cv, i, values[i]);
+  }
+}
+
+// set all controllers to the values in an array without ramping
+static inline void jump_all_cv(CVRamps *cv, const float *values) {
+  memcpy(cv->target, values, sizeof(cv->target));
+  memcpy(cv->value, values, sizeof(cv->value));
+  memset(cv->remaining, 0, sizeof(cv->remaining));
+  cv->ramping_count = 0;
+  cv->steady = 0;
+}
+
+// fill in controller values for the given number of samples, which must be
+//  no more than CV_FRAME_COUNT, advancing any ramps in progress
+static inline void fill_cv_frames(CVRamps *cv, int count) {
+  // when nothing is changing, the frames only need filling once
+  if (cv->ramping_count == 0) {
+    if (cv->steady) return;
+    for (int i = 0; i < CV_FRAME_COUNT; i++) {
+      memcpy(cv->frames[i], cv->value, sizeof(cv->value));
+    }
+    cv->steady = 1;
+    return;
+  }
+  for (int i = 0; i < count; i++) {
+    int r = 0;
+    while (r < cv->ramping_count) {
+      int index = cv->ramping[r];
+      if (--cv->remaining[index] > 0) {
+        cv->value[index] += cv->delta[index];
+        r++;
+      }
+      // finish the ramp exactly on its target
+      else {
+        cv->value[index] = cv->target[index];
+        cv->ramping[r] = cv->ramping[--cv->ramping_count];
+      }
+    }
+    memcpy(cv->frames[i], cv->value, sizeof(cv->value));
+  }
+}
+
+#endif
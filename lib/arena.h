@@ -0,0 +1,212 @@
+#ifndef CSYNTH_ARENA_H
+#define CSYNTH_ARENA_H
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <new>
+
+namespace CSynth {
+
+/// # Arena Allocation #
+///
+/// A patch typically makes many small objects with `new` when a voice is
+/// constructed, and if they're scattered around the heap, stepping dozens of
+/// voices every sample means constantly missing the processor's cache. An
+/// `Arena` hands out memory from large blocks in the order it's asked for,
+/// so everything made while constructing one voice ends up side by side.
+///
+/// The plugin makes an arena for each instance of a patch and makes it
+/// current while constructing voices and the master section, so patches
+/// don't need to do anything to benefit. Generators made with `new` and the
+/// sample buffers of classes like `Delay` are allocated from the current
+/// arena if there is one, and from the heap otherwise. Deleting something
+/// that came from an arena does nothing; the memory is all released at once
+/// when the arena is destroyed.
+///
+/// To use an arena directly, make it current for a block of code with an
+/// `ArenaScope`:
+///
+/// ```c++
+/// Arena arena;
+/// {
+///   ArenaScope scope(&arena);
+///   Sine *osc = new Sine(440.0); // allocated from the arena
+/// }
+/// ```
+///
+
+// the default size of the blocks an arena allocates memory from
+#define ARENA_BLOCK_SIZE 65536
+// a tag stored before each allocation saying where it came from
+#define ARENA_TAG_HEAP  0x48454150
+#define ARENA_TAG_ARENA 0x4152454e
+
+// a header placed before each allocation, sized to keep the memory after
+//  it aligned for any type
+struct alignas(alignof(max_align_t)) ArenaHeader {
+  uint32_t tag;
+};
+
+class Arena {
+protected:
+  // a block of memory that allocations are taken from
+  struct Block {
+    Block *next;
+    size_t size;
+    size_t used;
+  };
+  Block *blocks;
+  // the size of a block's header, rounded up to keep its memory aligned
+  static size_t blockHeaderSize() {
+    return(sizeof(ArenaHeader) *
+      ((sizeof(Block) + sizeof(ArenaHeader) - 1) / sizeof(ArenaHeader)));
+  }
+  // the start of the usable memory in a block
+  static char *blockData(Block *block) {
+    return((char *)block + blockHeaderSize());
+  }
+public:
+  Arena() {
+    blocks = NULL;
+  }
+  ~Arena() {
+    release();
+  }
+  /// The `allocate` method returns `size` bytes of memory aligned for any
+  /// type, or `NULL` if no memory is available.
+  void *allocate(size_t size) {
+    size_t align = sizeof(ArenaHeader);
+    size = ((size + align - 1) / align) * align;
+    if ((blocks == NULL) || (blocks->used + size > blocks->size)) {
+      size_t blockSize = (size > ARENA_BLOCK_SIZE) ? size : ARENA_BLOCK_SIZE;
+      Block *block = (Block *)::operator new(blockHeaderSize() + blockSize,
+                                             std::nothrow);
+      if (block == NULL) return(NULL);
+      block->size = blockSize;
+      block->used = 0;
+      // keep allocating from the current block if it has more room left
+      //  than the new one will after this allocation
+      if ((blocks != NULL) &&
+          (blocks->size - blocks->used > blockSize - size)) {
+        block->next = blocks->next;
+        blocks->next = block;
+      }
+      else {
+        block->next = blocks;
+        blocks = block;
+      }
+      block->used = size;
+      return(blockData(block));
+    }
+    void *p = blockData(blocks) + blocks->used;
+    blocks->used += size;
+    return(p);
+  }
+  /// The `size` method returns the total number of bytes allocated.
+  size_t size() {
+    size_t total = 0;
+    for (Block *block = blocks; block != NULL; block = block->next) {
+      total += block->used;
+    }
+    return(total);
+  }
+  /// The `release` method frees all memory allocated from the arena at
+  /// once. Anything constructed in it must already have been destroyed.
+  void release() {
+    while (blocks != NULL) {
+      Block *next = blocks->next;
+      ::operator delete(blocks);
+      blocks = next;
+    }
+  }
+  // the arena allocations on this thread are currently taken from, if any
+  static Arena *&current() {
+    static thread_local Arena *arena = NULL;
+    return(arena);
+  }
+  // test the arena
+  static void test();
+};
+
+// make an arena current until the end of the enclosing block
+class ArenaScope {
+protected:
+  Arena *previous;
+public:
+  ArenaScope(Arena *arena) {
+    previous = Arena::current();
+    Arena::current() = arena;
+  }
+  ~ArenaScope() {
+    Arena::current() = previous;
+  }
+};
+
+// allocate memory from the current arena, or from the heap if there isn't one
+static inline void *arenaAllocate(size_t size) {
+  Arena *arena = Arena::current();
+  ArenaHeader *header = NULL;
+  if (arena != NULL) {
+    header = (ArenaHeader *)arena->allocate(sizeof(ArenaHeader) + size);
+    if (header == NULL) throw std::bad_alloc();
+    header->tag = ARENA_TAG_ARENA;
+  }
+  else {
+    header = (ArenaHeader *)::operator new(sizeof(ArenaHeader) + size);
+    header->tag = ARENA_TAG_HEAP;
+  }
+  return(header + 1);
+}
+
+// free memory from arenaAllocate, which only needs doing if it's on the heap
+static inline void arenaFree(void *p) {
+  if (p == NULL) return;
+  ArenaHeader *header = (ArenaHeader *)p - 1;
+  assert((header->tag == ARENA_TAG_HEAP) || (header->tag == ARENA_TAG_ARENA));
+  if (header->tag == ARENA_TAG_HEAP) ::operator delete(header);
+}
+
+// allocate and free arrays of samples, zeroed on allocation
+static inline float *allocateSamples(int count) {
+  float *samples = (float *)arenaAllocate(count * sizeof(float));
+  for (int i = 0; i < count; i++) samples[i] = 0.0;
+  return(samples);
+}
+static inline void freeSamples(float *samples) {
+  arenaFree(samples);
+}
+
+inline void Arena::test() {
+  Arena arena;
+  // allocations are aligned and laid out in order
+  char *a = (char *)arena.allocate(3);
+  char *b = (char *)arena.allocate(8);
+  assert(((uintptr_t)a % sizeof(ArenaHeader)) == 0);
+  assert(b == a + sizeof(ArenaHeader));
+  assert(arena.size() == 2 * sizeof(ArenaHeader));
+  // large allocations get their own block
+  char *c = (char *)arena.allocate(ARENA_BLOCK_SIZE * 2);
+  assert(c != NULL);
+  char *d = (char *)arena.allocate(8);
+  assert(d == b + sizeof(ArenaHeader));
+  // allocations come from the current arena inside a scope
+  float *heap = allocateSamples(4);
+  float *inArena;
+  {
+    ArenaScope scope(&arena);
+    inArena = allocateSamples(4);
+  }
+  assert(Arena::current() == NULL);
+  assert(((ArenaHeader *)inArena - 1)->tag == ARENA_TAG_ARENA);
+  assert(((ArenaHeader *)heap - 1)->tag == ARENA_TAG_HEAP);
+  assert(inArena[3] == 0.0);
+  freeSamples(heap);
+  freeSamples(inArena);
+  arena.release();
+  assert(arena.size() == 0);
+}
+
+} // end namespace
+
+#endif
@@ -0,0 +1,350 @@
+// use a realistic sample rate for timing, fixed when the library is built 
+//  unless the benchmarks are measuring the step time being set at run time
+#ifndef BENCH_RUNTIME_STEP_TIME
+#define STEP_TIME (1.0 / 48000.0)
+#endif
+#include "synth.h"
+
+#include <time.h>
+#include <vector>
+
+using namespace CSynth;
+
+// this program measures the speed of parts of the synth library
+
+// the number of voices and samples to run each benchmark for
+#define BENCH_VOICES 64
+#define BENCH_SAMPLES 48000
+
+// get the current time in seconds
+static double benchTime() {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return((double)t.tv_sec + ((double)t.tv_nsec * 1.0e-9));
+}
+
+// print the time taken per sample of a benchmark
+static void benchReport(const char *name, double seconds, long samples) {
+  printf("  %-32s %8.2f ns/sample\n", name, (seconds * 1.0e9) / samples);
+}
+
+// a voice built from many small modules like a typical patch
+class BenchVoice {
+public:
+  WhiteNoise *noise;
+  Amplifier *amp;
+  AD *env;
+  Delay *waveGuide;
+  Splitter *split;
+  Delay *bounce;
+  Sine *lfo;
+  ADSR *level;
+  BenchVoice() {
+    noise = new WhiteNoise();
+    amp = new Amplifier(noise);
+    env = new AD(0.0, 0.01);
+    waveGuide = new Delay(amp, 0.005);
+    waveGuide->feedback = 0.95;
+    split = new Splitter(waveGuide, 2);
+    bounce = new Delay(&(split->output[1]), 0.01);
+    lfo = new Sine(4.0);
+    level = new ADSR(0.01, 0.1, 0.5, 0.2);
+  }
+  float step(float v) {
+    amp->ratio = env->step(v);
+    float s = split->output[0].step() + bounce->step();
+    return(s * lfo->step() * level->step(v));
+  }
+};
+
+// time stepping a set of voices
+static double benchVoices(BenchVoice **voices) {
+  float sum = 0.0;
+  double start = benchTime();
+  for (int i = 0; i < BENCH_SAMPLES; i++) {
+    float v = (i % 4800) < 2400 ? 1.0 : 0.0;
+    for (int j = 0; j < BENCH_VOICES; j++) {
+      sum += voices[j]->step(v);
+    }
+  }
+  double elapsed = benchTime() - start;
+  // use the output so the loop isn't optimized away
+  if (sum == 12345.0) printf("%f\n", sum);
+  return(elapsed);
+}
+
+// compare voices allocated on a fragmented heap to voices allocated
+//  from an arena
+static void benchArena() {
+  printf("arena allocation (%d voices):\n", BENCH_VOICES);
+  // fragment the heap by freeing every other block of a random-sized set,
+  //  as happens over time in a long-running host
+  std::vector<char *> blocks;
+  srand(1);
+  for (int i = 0; i < 20000; i++) blocks.push_back(new char[16 + (rand() % 512)]);
+  for (size_t i = 0; i < blocks.size(); i += 2) {
+    delete[] blocks[i];
+    blocks[i] = NULL;
+  }
+  BenchVoice *heapVoices[BENCH_VOICES];
+  for (int i = 0; i < BENCH_VOICES; i++) heapVoices[i] = new BenchVoice();
+  // make the same voices in an arena
+  Arena arena;
+  BenchVoice *arenaVoices[BENCH_VOICES];
+  {
+    ArenaScope scope(&arena);
+    for (int i = 0; i < BENCH_VOICES; i++) {
+      arenaVoices[i] = new (arena.allocate(sizeof(BenchVoice))) BenchVoice();
+    }
+  }
+  // warm up both, then alternate runs to even out noise
+  benchVoices(heapVoices);
+  benchVoices(arenaVoices);
+  double heapTime = 0.0, arenaTime = 0.0;
+  for (int run = 0; run < 3; run++) {
+    heapTime += benchVoices(heapVoices);
+    arenaTime += benchVoices(arenaVoices);
+  }
+  long samples = 3L * BENCH_SAMPLES * BENCH_VOICES;
+  benchReport("heap", heapTime, samples);
+  benchReport("arena", arenaTime, samples);
+  printf("  arena speedup: %.2fx (%lu bytes in arena)\n",
+         heapTime / arenaTime, (unsigned long)arena.size());
+  for (size_t i = 0; i < blocks.size(); i++) delete[] blocks[i];
+}
+
+// a modulation chain of the kind that changes slowly: an envelope and two 
+//  LFOs mixed together
+class BenchModulation {
+public:
+  ADSR env;
+  Sine lfo;
+  Triangle lfo2;
+  Mixer mix;
+  SlewRateLimiter slew;
+  // the same outputs evaluated at control rate
+  ControlRate level;
+  ControlRate mod;
+  BenchModulation() : env(0.01, 0.1, 0.5, 0.2), lfo(5.0), lfo2(0.3), 
+      mix(&lfo, &lfo2), slew(&mix, 0.01, 0.01), level(&env), mod(&slew) { }
+};
+
+// time running a modulation chain on every sample against evaluating it at 
+//  control rate
+static void benchControlRate() {
+  printf("control rate (interval %d):\n", CONTROL_INTERVAL);
+  BenchModulation audio[BENCH_VOICES];
+  BenchModulation control[BENCH_VOICES];
+  float sum = 0.0;
+  double audioTime = 0.0, controlTime = 0.0;
+  for (int run = 0; run < 3; run++) {
+    double start = benchTime();
+    for (int i = 0; i < BENCH_SAMPLES; i++) {
+      float v = (i % 4800) < 2400 ? 1.0 : 0.0;
+      for (int j = 0; j < BENCH_VOICES; j++) {
+        sum += audio[j].env.step(v) * audio[j].slew.step();
+      }
+    }
+    audioTime += benchTime() - start;
+    start = benchTime();
+    for (int i = 0; i < BENCH_SAMPLES; i++) {
+      float v = (i % 4800) < 2400 ? 1.0 : 0.0;
+      for (int j = 0; j < BENCH_VOICES; j++) {
+        sum += control[j].level.step(v) * control[j].mod.step();
+      }
+    }
+    controlTime += benchTime() - start;
+  }
+  if (sum == 12345.0) printf("%f\n", sum);
+  long samples = 3L * BENCH_SAMPLES * BENCH_VOICES;
+  benchReport("audio rate", audioTime, samples);
+  benchReport("control rate", controlTime, samples);
+  printf("  control rate speedup: %.2fx\n", audioTime / controlTime);
+}
+
+// time four separate biquads against one four-lane biquad
+static void benchFilters() {
+  printf("filters (4 signals x %d voices):\n", BENCH_VOICES);
+  Biquad single[BENCH_VOICES][4];
+  Biquad4 wide[BENCH_VOICES];
+  float buffers[4][64];
+  float *lanes[4] = { buffers[0], buffers[1], buffers[2], buffers[3] };
+  for (int j = 0; j < BENCH_VOICES; j++) {
+    for (int i = 0; i < 4; i++) {
+      single[j][i].cutoff = wide[j].cutoff[i] = 500.0 * (i + 1);
+    }
+  }
+  float sum = 0.0;
+  double singleTime = 0.0, wideTime = 0.0;
+  for (int run = 0; run < 3; run++) {
+    double start = benchTime();
+    for (int n = 0; n < BENCH_SAMPLES; n += 64) {
+      for (int j = 0; j < BENCH_VOICES; j++) {
+        for (int i = 0; i < 4; i++) {
+          for (int k = 0; k < 64; k++) buffers[i][k] = (float)((k * 7) % 13);
+          single[j][i].process(buffers[i], 64);
+        }
+        sum += buffers[0][63];
+      }
+    }
+    singleTime += benchTime() - start;
+    start = benchTime();
+    for (int n = 0; n < BENCH_SAMPLES; n += 64) {
+      for (int j = 0; j < BENCH_VOICES; j++) {
+        for (int i = 0; i < 4; i++) {
+          for (int k = 0; k < 64; k++) buffers[i][k] = (float)((k * 7) % 13);
+        }
+        wide[j].process(lanes, 64);
+        sum += buffers[0][63];
+      }
+    }
+    wideTime += benchTime() - start;
+  }
+  if (sum == 12345.0) printf("%f\n", sum);
+  long samples = 3L * BENCH_SAMPLES * BENCH_VOICES;
+  benchReport("4 x Biquad", singleTime, samples);
+  benchReport("Biquad4", wideTime, samples);
+  printf("  four-lane speedup: %.2fx\n", singleTime / wideTime);
+}
+
+// time a ladder filter with a swept cutoff on a set of voices
+static double benchLadder(bool exact, int interval, int oversample) {
+  Saw osc[BENCH_VOICES];
+  Ladder filters[BENCH_VOICES];
+  for (int j = 0; j < BENCH_VOICES; j++) {
+    osc[j].frequency = 110.0 + j;
+    filters[j].source = &osc[j];
+    filters[j].resonance = 0.7;
+    filters[j].drive = 2.0;
+    filters[j].exact = exact;
+    filters[j].interval = interval;
+    filters[j].oversample = oversample;
+  }
+  float sum = 0.0;
+  double start = benchTime();
+  for (int i = 0; i < BENCH_SAMPLES; i++) {
+    float cutoff = 500.0 + (float)(i % 4800);
+    for (int j = 0; j < BENCH_VOICES; j++) {
+      filters[j].cutoff = cutoff;
+      sum += filters[j].step();
+    }
+  }
+  double elapsed = benchTime() - start;
+  if (sum == 12345.0) printf("%f\n", sum);
+  return(elapsed);
+}
+
+// compare the ladder filter's approximations to the exact version
+static void benchLadders() {
+  printf("ladder filter (%d voices, swept cutoff):\n", BENCH_VOICES);
+  double exactTime = benchLadder(true, 1, 1);
+  double fastTime = benchLadder(false, CONTROL_INTERVAL, 1);
+  double oversampledTime = benchLadder(false, CONTROL_INTERVAL, 2);
+  long samples = (long)BENCH_SAMPLES * BENCH_VOICES;
+  benchReport("exact tanh, cutoff every sample", exactTime, samples);
+  benchReport("fast tanh, control-rate cutoff", fastTime, samples);
+  benchReport("fast, 2x oversampled", oversampledTime, samples);
+  printf("  ladder speedup: %.2fx\n", exactTime / fastTime);
+}
+
+// time a tree of two-input mixers against a wide mixer for 8 signals
+static void benchMixers() {
+  printf("mixers (8 signals x %d voices):\n", BENCH_VOICES);
+  static Saw osc[BENCH_VOICES][8];
+  static Mixer tree[BENCH_VOICES][7];
+  static WideMixer wide[BENCH_VOICES];
+  for (int j = 0; j < BENCH_VOICES; j++) {
+    for (int i = 0; i < 8; i++) {
+      osc[j][i].frequency = 110.0 * (i + 1);
+      wide[j].add(&osc[j][i], 0.125);
+    }
+    // the first four mixers take pairs of oscillators, the rest pairs of
+    //  mixers
+    for (int i = 0; i < 4; i++) {
+      tree[j][i].source = &osc[j][i * 2];
+      tree[j][i].source2 = &osc[j][(i * 2) + 1];
+    }
+    for (int i = 4; i < 7; i++) {
+      tree[j][i].source = &tree[j][(i - 4) * 2];
+      tree[j][i].source2 = &tree[j][((i - 4) * 2) + 1];
+    }
+  }
+  float sum = 0.0;
+  float buffer[64];
+  double start = benchTime();
+  for (int n = 0; n < BENCH_SAMPLES; n++) {
+    for (int j = 0; j < BENCH_VOICES; j++) sum += tree[j][6].step();
+  }
+  double treeTime = benchTime() - start;
+  start = benchTime();
+  for (int n = 0; n < BENCH_SAMPLES; n++) {
+    for (int j = 0; j < BENCH_VOICES; j++) sum += wide[j].step();
+  }
+  double stepTime = benchTime() - start;
+  start = benchTime();
+  for (int n = 0; n < BENCH_SAMPLES; n += 64) {
+    for (int j = 0; j < BENCH_VOICES; j++) {
+      wide[j].render(buffer, 64);
+      sum += buffer[63];
+    }
+  }
+  double renderTime = benchTime() - start;
+  if (sum == 12345.0) printf("%f\n", sum);
+  long samples = (long)BENCH_SAMPLES * BENCH_VOICES;
+  benchReport("tree of 7 Mixers", treeTime, samples);
+  benchReport("WideMixer step", stepTime, samples);
+  benchReport("WideMixer render", renderTime, samples);
+  printf("  wide mixer speedup: %.2fx\n", treeTime / stepTime);
+}
+
+// time stepping envelopes against rendering them in blocks
+static void benchEnvelopes() {
+  printf("envelopes (%d voices):\n", BENCH_VOICES);
+  static ADSR env[BENCH_VOICES];
+  for (int j = 0; j < BENCH_VOICES; j++) {
+    env[j].attack = 0.01 + (j * 0.001);
+    env[j].decay = 0.1;
+    env[j].sustain = 0.5;
+    env[j].release = 0.2;
+    env[j].curve = (j % 2) ? EnvelopeExponential : EnvelopeLinear;
+  }
+  float sum = 0.0;
+  float buffer[64];
+  // hold each note for half a second and release it for half a second
+  double start = benchTime();
+  for (int n = 0; n < BENCH_SAMPLES; n++) {
+    float v = ((n / 24000) % 2) ? 0.0 : 1.0;
+    for (int j = 0; j < BENCH_VOICES; j++) sum += env[j].step(v);
+  }
+  double stepTime = benchTime() - start;
+  start = benchTime();
+  for (int n = 0; n < BENCH_SAMPLES; n += 64) {
+    float v = ((n / 24000) % 2) ? 0.0 : 1.0;
+    for (int j = 0; j < BENCH_VOICES; j++) {
+      env[j].render(v, buffer, 64);
+      sum += buffer[63];
+    }
+  }
+  double renderTime = benchTime() - start;
+  if (sum == 12345.0) printf("%f\n", sum);
+  long samples = (long)BENCH_SAMPLES * BENCH_VOICES;
+  benchReport("ADSR step", stepTime, samples);
+  benchReport("ADSR render", renderTime, samples);
+  printf("  envelope render speedup: %.2fx\n", stepTime / renderTime);
+}
+
+int main() {
+#ifdef BENCH_RUNTIME_STEP_TIME
+  StepTimeScope timeScope(1.0 / 48000.0);
+  printf("step time set at run time\n");
+#else
+  printf("step time fixed when built\n");
+#endif
+  benchArena();
+  benchControlRate();
+  benchFilters();
+  benchLadders();
+  benchMixers();
+  benchEnvelopes();
+  return(0);
+}
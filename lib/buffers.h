@@ -184,7 +184,7 @@ public:
       samples = round(samples);
     }
     if (! (samples > 0.0)) {
-      delete[] buffer;
+      freeSamples(buffer);
       buffer = NULL;
       bufferLen = insertIndex = 0;
       samples = remainder = seconds = 0.0;
@@ -195,10 +195,8 @@ public:
     // if the buffer size isn't changing, there's nothing to do
     if (newBufferLen == bufferLen) return;
     // allocate a new buffer
-    float *newBuffer = new float[newBufferLen];
+    float *newBuffer = allocateSamples(newBufferLen);
     if (newBuffer == NULL) return;
-    // clear it with zeros to make sure there's no noise in the new buffer
-    memset(newBuffer, 0, newBufferLen * sizeof(*newBuffer));
     // if the old buffer doesn't exist, we're done
     if (buffer == NULL) {
       buffer = newBuffer;
@@ -244,7 +242,7 @@ public:
       if (++i >= nonOverlapLen) taper -= taperStep;
     }
     // swap in the new buffer
-    delete[] buffer;
+    freeSamples(buffer);
     buffer = newBuffer;
     bufferLen = newBufferLen;
     insertIndex = 0;
@@ -376,6 +374,7 @@ public:
     setDelay(length, flags);
   }
   virtual float step() {
+    CSYNTH_PROFILE_SCOPE(Delay);
     // get input from the source
     float in = Processor::step();
     // output the input if there is no delay
@@ -399,7 +398,7 @@ public:
     return(out);
   }
   ~Delay() {
-    if (buffer != NULL) delete[] buffer;
+    freeSamples(buffer);
   }
   // test the delay line
   static void test() {
@@ -0,0 +1,317 @@
+#ifndef CSYNTH_CONTROL_H
+#define CSYNTH_CONTROL_H
+
+#include "envelopes.h"
+#include "signals.h"
+
+namespace CSynth {
+
+/// # Control Rate #
+///
+/// Many of the signals in a patch change slowly compared to the sample rate,
+/// like LFOs, envelopes, and values derived from controllers. Computing them
+/// for every sample wastes time that could be spent on more voices, so the
+/// classes below evaluate them every few samples instead, and smooth the
+/// result back out to audio rate.
+///
+/// Include the following code to use the classes below:
+///
+/// ```c++
+/// #include "control.h"
+/// using namespace CSynth;
+/// ```
+///
+/// The number of samples between evaluations is `CONTROL_INTERVAL`, which
+/// defaults to 16 and can be changed by defining it before including the
+/// library. Each class can also be given its own interval.
+///
+#ifndef CONTROL_INTERVAL
+#define CONTROL_INTERVAL 16
+#endif
+///
+/// The way values are filled in between evaluations is set with one of the
+/// following modes:
+///
+///  - `ControlHold` holds each value until the next one, which is cheapest
+///    but can produce a stepped "zipper" sound on audible parameters.
+///  - `ControlLinear` ramps linearly from one value to the next.
+///  - `ControlSmooth` eases in and out of each value with a smoothstep
+///    curve, which avoids sudden changes in slope.
+///
+enum ControlInterpolation {
+  ControlHold,
+  ControlLinear,
+  ControlSmooth
+};
+///
+/// # ControlRate #
+///
+/// The `ControlRate` class is a processor that evaluates its source at
+/// control rate by [advancing](generators.h.md) it a whole interval at a
+/// time, then interpolates between the values it gets. Processors and
+/// oscillators connected to the source are advanced along with it, so a
+/// whole modulation chain can be moved to control rate by wrapping its
+/// output.
+///
+/// ```c++
+/// Sine lfo(4.0);
+/// ControlRate vibrato(&lfo); // evaluates the LFO every 16 samples
+/// float sample = vibrato.step();
+/// ```
+///
+/// An envelope can also be used as the source, in which case the velocity
+/// is passed to the `step` method as usual:
+///
+/// ```c++
+/// ADSR env(0.01, 0.1, 0.5, 0.2);
+/// ControlRate level(&env, 32, ControlSmooth);
+/// float sample = osc.step() * level.step(velocity);
+/// ```
+///
+/// When interpolating, the output reaches each value at the end of the
+/// interval it was evaluated at, so it lags the source by one interval. At
+/// the default interval and a 48 kHz sample rate that's a third of a
+/// millisecond, which is too short to hear on modulation. Generators that
+/// keep a history of samples like `Delay` don't make sense at control rate
+/// and shouldn't be connected to the source.
+///
+class ControlRate : public Processor {
+protected:
+  // the envelope to pass velocity to, if the source is an envelope
+  Envelope *_envelope;
+  // the values being interpolated between
+  float _from, _to;
+  // the number of samples left before the next evaluation
+  int _remaining;
+  // whether a value has been evaluated yet
+  bool _started;
+public:
+  /// ## Properties ##
+  ///
+  /// The `interval` property is the number of samples between evaluations
+  /// of the source.
+  int interval;
+  ///
+  /// The `interpolation` property sets how values are filled in between
+  /// evaluations, as described above.
+  ControlInterpolation interpolation;
+  ///
+  /// ## Constructors ##
+  ///
+  /// A control-rate processor is made from a source generator or envelope
+  /// and optionally an interval and interpolation mode, which default to
+  /// `CONTROL_INTERVAL` and `ControlLinear`.
+  ///
+  ControlRate() : Processor() {
+    _envelope = NULL;
+    _from = _to = 0.0;
+    _remaining = 0;
+    _started = false;
+    interval = CONTROL_INTERVAL;
+    interpolation = ControlLinear;
+  }
+  ControlRate(Generator *s, int i = CONTROL_INTERVAL,
+              ControlInterpolation mode = ControlLinear) : ControlRate() {
+    source = s;
+    interval = i;
+    interpolation = mode;
+  }
+  ControlRate(Envelope *e, int i = CONTROL_INTERVAL,
+              ControlInterpolation mode = ControlLinear) :
+      ControlRate((Generator *)e, i, mode) {
+    _envelope = e;
+  }
+  /// ## Methods ##
+  ///
+  /// The `step` method returns the next interpolated sample, evaluating the
+  /// source whenever an interval has passed. When the source is an envelope,
+  /// the velocity is passed as an argument and is sampled along with it.
+  ///
+  virtual float step(float v) {
+    CSYNTH_PROFILE_SCOPE(ControlRate);
+    if (_remaining <= 0) {
+      _from = _to;
+      if (_envelope != NULL) _to = _envelope->advance(v, interval * _steps);
+      else if (source != NULL) _to = source->advance(interval * _steps);
+      else _to = 0.0;
+      // don't ramp up from nothing on the first evaluation
+      if (! _started) {
+        _from = _to;
+        _started = true;
+      }
+      _remaining = interval;
+    }
+    float x = (float)(interval - _remaining) / (float)interval;
+    _remaining -= _steps;
+    if (interpolation == ControlHold) return(_to);
+    if (interpolation == ControlSmooth) x = x * x * (3.0 - (2.0 * x));
+    return(_from + ((_to - _from) * x));
+  }
+  virtual float step() {
+    return(step(0.0));
+  }
+  // test the control-rate processor
+  static void test() {
+    // a saw rising by one unit per sample
+    Saw gen(1.0 / (16.0 * STEP_TIME));
+    gen.setRange(0.0, 16.0);
+    ControlRate linear(&gen, 4);
+    assert(linear.step() == 0.0); // the first interval holds
+    assert(linear.step() == 0.0);
+    assert(linear.step() == 0.0);
+    assert(linear.step() == 0.0);
+    assert(linear.step() == 0.0); // then ramps to each evaluation
+    assert(linear.step() == 1.0);
+    assert(linear.step() == 2.0);
+    assert(linear.step() == 3.0);
+    assert(linear.step() == 4.0);
+    Saw gen2(1.0 / (16.0 * STEP_TIME));
+    gen2.setRange(0.0, 16.0);
+    ControlRate hold(&gen2, 4, ControlHold);
+    for (int i = 0; i < 4; i++) assert(hold.step() == 0.0);
+    for (int i = 0; i < 4; i++) assert(hold.step() == 4.0);
+    // advancing an envelope covers the same time as stepping it
+    ADSR env(4 * STEP_TIME, 4 * STEP_TIME, 0.5, 4 * STEP_TIME);
+    ControlRate level(&env, 2, ControlHold);
+    assert(level.step(1.0) == 0.5); // attack
+    level.step(1.0);
+    assert(level.step(1.0) == 1.0); // peak
+    level.step(1.0);
+    assert(level.step(1.0) == 0.75); // decay
+  }
+};
+///
+/// # ControlValue #
+///
+/// The `ControlValue` class is a generator that smooths values computed in
+/// code rather than by a generator, like parameters derived from controller
+/// inputs. Each time the `set` method is called, the output ramps to the new
+/// value over one interval.
+///
+/// ```c++
+/// ControlValue cutoff;
+/// cutoff.set(200.0 + (cv[1] * 2000.0));
+/// float f = cutoff.step();
+/// ```
+///
+class ControlValue : public Generator {
+protected:
+  // the amount to change the value by each sample
+  float _delta;
+  // the number of samples left in the current ramp
+  int _remaining;
+  // whether a value has been set yet
+  bool _started;
+public:
+  /// ## Properties ##
+  ///
+  /// The `value` property is the current output value, and `target` is the
+  /// value it's ramping toward.
+  float value, target;
+  ///
+  /// The `interval` property is the number of samples a ramp takes.
+  int interval;
+  ///
+  /// ## Constructors ##
+  ///
+  /// The value starts at zero, or can be passed to the constructor along
+  /// with an interval.
+  ///
+  ControlValue(float v = 0.0, int i = CONTROL_INTERVAL) : Generator() {
+    value = target = v;
+    interval = i;
+    _delta = 0.0;
+    _remaining = 0;
+    _started = false;
+  }
+  /// ## Methods ##
+  ///
+  /// The `set` method starts a ramp to a new value. The first value set
+  /// takes effect immediately so the output doesn't sweep up from zero.
+  ///
+  void set(float v) {
+    target = v;
+    if ((! _started) || (interval <= 1)) {
+      value = v;
+      _remaining = 0;
+      _started = true;
+      return;
+    }
+    _delta = (target - value) / (float)interval;
+    _remaining = interval;
+  }
+  ///
+  /// The `step` method returns the current value and moves it along the ramp.
+  ///
+  virtual float step() {
+    float out = value;
+    if (_remaining > 0) {
+      _remaining -= _steps;
+      if (_remaining > 0) value += _delta * _steps;
+      else value = target;
+    }
+    return(out);
+  }
+  // test the control value
+  static void test() {
+    ControlValue v(0.0, 4);
+    v.set(2.0);
+    assert(v.step() == 2.0); // the first value is immediate
+    v.set(6.0);
+    assert(v.step() == 2.0);
+    assert(v.step() == 3.0);
+    assert(v.step() == 4.0);
+    assert(v.step() == 5.0);
+    assert(v.step() == 6.0);
+    assert(v.step() == 6.0);
+  }
+};
+///
+/// # ControlClock #
+///
+/// The `ControlClock` class counts samples so a patch can do its own
+/// parameter calculations at control rate. Its `tick` method should be
+/// called once per sample, and returns true on the first sample and then
+/// once every interval.
+///
+/// ```c++
+/// ControlClock clock;
+/// ControlValue amount;
+/// float step(float f, float v, float *cv) {
+///   if (clock.tick()) amount.set(pow(cv[1], 2.0) * f);
+///   ...
+/// }
+/// ```
+///
+class ControlClock {
+protected:
+  // the number of samples left before the next tick
+  int _remaining;
+public:
+  /// The `interval` property is the number of samples between ticks.
+  int interval;
+  ControlClock(int i = CONTROL_INTERVAL) {
+    interval = i;
+    _remaining = 0;
+  }
+  bool tick() {
+    if (_remaining > 0) {
+      _remaining--;
+      return(false);
+    }
+    _remaining = interval - 1;
+    return(true);
+  }
+  // test the clock
+  static void test() {
+    ControlClock clock(3);
+    assert(clock.tick());
+    assert(! clock.tick());
+    assert(! clock.tick());
+    assert(clock.tick());
+  }
+};
+
+} // end namespace
+
+#endif
@@ -22,9 +22,8 @@ namespace CSynth {
 /// ```
 ///
 /// Subclasses of the `Trigger` class watch for changes to a value and call a 
-/// given function when that value makes a given transition. They are used by 
-/// envelopes to move through their stages when, for example, a key is pressed 
-/// or released.
+/// given function when that value makes a given transition, for example 
+/// when a key is pressed or released.
 typedef std::function<void(float)> TriggerAction;
 ///
 class Trigger {
@@ -92,6 +91,9 @@ class RiseTrigger : public Trigger {
 protected:
   float last;
 public:
+  RiseTrigger() : Trigger() {
+    last = 0.0;
+  }
   virtual void step(float v) {
     if ((last <= threshold) && (v > threshold)) { action(v); }
     last = v;
@@ -119,6 +121,9 @@ class FallTrigger : public Trigger {
 protected:
   float last;
 public:
+  FallTrigger() : Trigger() {
+    last = 0.0;
+  }
   virtual void step(float v) {
     if ((last > threshold) && (v <= threshold)) { action(v); }
     last = v;
@@ -173,10 +178,138 @@ typedef enum {
   ReleasePhase
 } EnvelopePhase;
 ///
+/// The `EnvelopeCurve` enumeration lists the shapes an envelope's segments
+/// can have:
+///
+///  - `EnvelopeLinear` moves in straight lines, like the diagram above.
+///  - `EnvelopeExponential` moves like the voltage on a charging or
+///    discharging capacitor, fast at first and slowing as it nears the end
+///    of each segment, which is how analog envelopes sound. Each segment 
+///    still ends after the time it's given.
+///
+typedef enum {
+  EnvelopeLinear,
+  EnvelopeExponential
+} EnvelopeCurve;
+
+// how far past the end of a segment exponential curves aim, relative to 
+//  the segment's size, where smaller values make sharper curves
+#define ENVELOPE_ATTACK_OVERSHOOT 0.3
+#define ENVELOPE_DECAY_OVERSHOOT 0.0001
+///
 class Envelope : public Generator {
 protected:
   // store the current phase of the envelope
   EnvelopePhase phase;
+  // the level the current phase started from
+  float _phaseStart;
+  // the last velocity, to detect notes starting and stopping
+  float _velocity;
+  // each step of the current segment sets value to value * _coef + _base
+  double _coef, _base;
+  // where an exponential segment is heading, past its end
+  double _target;
+  // the settings the coefficients were computed for
+  float _time, _from, _to;
+  double _overshoot;
+  // the number of steps left before the current segment lands on its end
+  int _left;
+  // whether notes are started and stopped by calls to noteOn and noteOff
+  //  rather than by watching the velocity
+  bool _gated;
+  // whether the last step moved along a segment (1), held a steady level
+  //  (-1), or neither (0)
+  int _ramp;
+  // compute the coefficients for a segment from one level to another 
+  //  taking the given time, and how many steps it has left from the 
+  //  current value
+  void _prepare(float time, float from, float to, double overshoot) {
+    _time = time;
+    _from = from;
+    _to = to;
+    _overshoot = overshoot;
+    double samples = time / sampleTime();
+    double steps;
+    if (curve == EnvelopeExponential) {
+      _target = to + ((to - from) * overshoot);
+      _coef = exp(-log((1.0 + overshoot) / overshoot) / samples);
+      _base = _target * (1.0 - _coef);
+      double ratio = (to - _target) / (value - _target);
+      steps = (ratio > 0.0) ? log(ratio) / log(_coef) : 0.0;
+    }
+    else {
+      _target = to;
+      _coef = 1.0;
+      _base = (to - from) / samples;
+      steps = (_base != 0.0) ? (to - value) / _base : 0.0;
+    }
+    // allow for rounding so a segment of a whole number of samples isn't
+    //  given an extra one
+    if (! (steps > 1.0)) _left = 1;
+    else if (steps > 1.0e9) _left = 1000000000;
+    else _left = (int)ceil(steps - 0.001);
+  }
+  // aim the current segment at a new end level without changing how long 
+  //  it has left, which is cheap enough to do every sample
+  void _retarget(float to) {
+    _to = to;
+    // a segment that has already landed just follows the level
+    if (_left <= 0) return;
+    if (_coef == 1.0) {
+      _target = to;
+      _base = (to - value) / _left;
+    }
+    else {
+      _target = to + ((to - _from) * _overshoot);
+      _base = _target * (1.0 - _coef);
+    }
+  }
+  // move the value along a segment, recomputing coefficients if its time
+  //  has changed or the segment was just entered, and only its levels if 
+  //  the end level has changed
+  inline void _advance(float time, float from, float to, double overshoot) {
+    if (time != _time) _prepare(time, from, to, overshoot);
+    else if (to != _to) _retarget(to);
+    if (_steps > 1) {
+      double coef = pow(_coef, _steps);
+      value = (value * coef) + ((_coef == 1.0) ? _base * _steps : 
+        _target * (1.0 - coef));
+      _left -= _steps;
+    }
+    else {
+      value = (value * _coef) + _base;
+      _left--;
+    }
+    // land exactly on the end of the segment when rounding leaves it short
+    if (_left <= 0) {
+      value = to;
+      _left = 0;
+    }
+    _ramp = 1;
+  }
+  // get the number of samples after the current one that stay inside the
+  //  current segment, leaving the step that finishes it to be taken normally
+  int _rampLength() {
+    return(_left - 1);
+  }
+  // move to a phase, remembering the level it starts from so its segment 
+  //  runs from there, which matters when a note is released early
+  inline void _enter(EnvelopePhase p) {
+    phase = p;
+    _phaseStart = value;
+    // make the next step compute coefficients for the new segment
+    _time = -1.0;
+  }
+  // note when the velocity crosses zero, returning 1 for the start of a 
+  //  note, -1 for the end, and 0 otherwise
+  inline int _edge(float v) {
+    if ((_gated) || (v == _velocity)) return(0);
+    int edge = 0;
+    if ((_velocity <= 0.0) && (v > 0.0)) edge = 1;
+    else if ((_velocity > 0.0) && (v <= 0.0)) edge = -1;
+    _velocity = v;
+    return(edge);
+  }
 public:
   /// ## Properties ###
   ///
@@ -218,6 +351,14 @@ public:
   /// the level of the sustain (usually 0.0 to 1.0), and the duration of the 
   /// release in seconds.
   ///
+  /// The `curve` property is the `EnvelopeCurve` of the segments, which is
+  /// `EnvelopeLinear` by default. A change to it takes effect at the start 
+  /// of the next segment, as does a change to `minValue` during the attack.
+  /// Changes to the times and to the level a segment ends at take effect 
+  /// right away, and the end level, such as the sustain, can change every 
+  /// sample without recomputing the shape of the segment.
+  EnvelopeCurve curve;
+  ///
   /// ## Constructors ##
   ///
   /// Envelopes can be set up in the following ways:
@@ -240,12 +381,24 @@ public:
   Envelope() : Generator() {
     phase = InitialPhase;
     value = 0.0;
+    _phaseStart = 0.0;
     attack = 0.0;
     decay = 0.0;
     sustain = 1.0;
     release = 0.0;
     minValue = 0.0;
     maxValue = 1.0;
+    curve = EnvelopeLinear;
+    _velocity = 0.0;
+    _coef = 1.0;
+    _base = _target = 0.0;
+    // make sure coefficients are computed for the first segment
+    _time = -1.0;
+    _from = _to = 0.0;
+    _overshoot = 0.0;
+    _left = 0;
+    _ramp = 0;
+    _gated = false;
   }
   /// ## Methods ##
   ///
@@ -269,6 +422,91 @@ public:
   virtual float step() {
     return(step(0.0));
   }
+  ///
+  /// Like other generators, envelopes can be moved forward several samples 
+  /// at a time with the `advance` method, which also takes the velocity.
+  ///
+  virtual float advance(float v, int samples) {
+    _steps = samples;
+    float level = step(v);
+    _steps = 1;
+    return(level);
+  }
+  using Generator::advance;
+  ///
+  /// Watching the velocity misses a note that starts while another is held,
+  /// if both have the same velocity. The `noteOn` and `noteOff` methods 
+  /// start and release notes directly instead, and can be called from a 
+  /// voice's own `noteOn` and `noteOff` methods (see [host.h](host.h.md)). 
+  /// Once `noteOn` has been called, the envelope stops watching the velocity
+  /// passed to `step` and only changes phase when these methods are called.
+  ///
+  /// ```c++
+  /// ADSR env(0.1, 0.1, 0.5, 0.1);
+  /// env.noteOn(0.5);
+  /// float level = env.step();
+  /// env.noteOff();
+  /// ```
+  ///
+  virtual void noteOn(float v) {
+    _gated = true;
+    _velocity = v;
+    _enter(AttackPhase);
+  }
+  virtual void noteOff() {
+    _gated = true;
+    _velocity = 0.0;
+  }
+  ///
+  /// The `render` method fills a buffer with the given number of samples 
+  /// for a velocity that stays the same throughout. It only steps the 
+  /// envelope where segments begin and end, and fills the samples between 
+  /// with a formula, so it does much less work than calling `step` for each
+  /// sample. Changes to the envelope's settings take effect at the start of
+  /// the next call.
+  ///
+  /// ```c++
+  /// ADSR env(0.1, 0.1, 0.5, 0.1);
+  /// float levels[64];
+  /// env.render(0.5, levels, 64);
+  /// ```
+  ///
+  virtual void render(float v, float *buffer, int count) {
+    int i = 0;
+    while (i < count) {
+      // take a normal step, which handles moving between segments
+      _ramp = 0;
+      float level = step(v);
+      buffer[i++] = level;
+      int n = count - i;
+      // hold a steady level for the rest of the block
+      if (_ramp < 0) {
+        for (int j = 0; j < n; j++) buffer[i + j] = level;
+        return;
+      }
+      // fill in the part of the segment that doesn't end it
+      if (_ramp == 0) continue;
+      int ramp = _rampLength();
+      if (ramp < n) n = ramp;
+      if (n <= 0) continue;
+      float *out = buffer + i;
+      if (_coef == 1.0) {
+        double start = value;
+        for (int j = 0; j < n; j++) out[j] = start + (_base * (j + 1));
+      }
+      else {
+        double offset = value - _target;
+        for (int j = 0; j < n; j++) {
+          offset *= _coef;
+          out[j] = _target + offset;
+        }
+      }
+      value = out[n - 1];
+      _left -= n;
+      i += n;
+    }
+  }
+  using Generator::render;
 };
 ///
 /// # ADSR #
@@ -276,15 +514,8 @@ public:
 /// The `ADSR` class implements a classic ADSR envelope with all four phases.
 ///
 class ADSR : public Envelope {
-protected:
-  // triggers for the attack and release
-  RiseTrigger attackTrigger;
-  FallTrigger releaseTrigger;
 public:
-  ADSR() : Envelope() {
-    attackTrigger.action = [&] (float v) { phase = AttackPhase; };
-    releaseTrigger.action = [&] (float v) { phase = ReleasePhase; };
-  }
+  ADSR() : Envelope() { }
   ADSR(float a, float d, float s, float r) : ADSR() {
     attack = a;
     decay = d;
@@ -292,35 +523,41 @@ public:
     release = r;
   }
   virtual float step(float v) {
-    attackTrigger.step(v);
-    releaseTrigger.step(v);
+    CSYNTH_PROFILE_SCOPE(ADSR);
+    int edge = _edge(v);
+    if (edge > 0) _enter(AttackPhase);
+    else if (edge < 0) _enter(ReleasePhase);
     // if we haven't triggered yet, return no output
-    if ((phase < AttackPhase) || (phase > ReleasePhase)) return(minValue);
+    if ((phase < AttackPhase) || (phase > ReleasePhase)) {
+      _ramp = -1;
+      return(minValue);
+    }
     // attack phase
     if (phase == AttackPhase) {
       if (attack <= 0.0) value = maxValue;
       if (value < maxValue) {
-        value += (STEP_TIME / attack) * (maxValue - minValue);
+        _advance(attack, minValue, maxValue, ENVELOPE_ATTACK_OVERSHOOT);
       }
-      else phase = DecayPhase;
+      else _enter(DecayPhase);
     }
     // decay
     if (phase == DecayPhase) {
       if (decay <= 0.0) value = sustain;
       if (value > sustain) {
-        value -= (STEP_TIME / decay) * (maxValue - sustain);
+        _advance(decay, _phaseStart, sustain, ENVELOPE_DECAY_OVERSHOOT);
       }
       else phase = SustainPhase;
     }
     // sustain
     if (phase == SustainPhase) {
       value = sustain;
+      _ramp = -1;
     }
     // release
     if (phase == ReleasePhase) {
       if (release <= 0.0) value = minValue;
       if (value > minValue) {
-        value -= (STEP_TIME / release) * (sustain - minValue);
+        _advance(release, _phaseStart, minValue, ENVELOPE_DECAY_OVERSHOOT);
       }
       else phase = InitialPhase;
     }
@@ -329,6 +566,10 @@ public:
     if (value > maxValue) value = maxValue;
     return(value);
   }
+  virtual void noteOff() {
+    Envelope::noteOff();
+    if ((phase >= AttackPhase) && (phase < ReleasePhase)) _enter(ReleasePhase);
+  }
   // test the ADSR envelope
   static void test() {
     ADSR env(2 * STEP_TIME, 2 * STEP_TIME, 1.0, 2 * STEP_TIME);
@@ -345,6 +586,89 @@ public:
       assert(env.step(0.0) == 0.0);  // ...
       assert(env.step(0.0) == 0.0);  // final state
     }
+    // exponential segments take the same time, but curve
+    ADSR curved(8 * STEP_TIME, 8 * STEP_TIME, 0.5, 8 * STEP_TIME);
+    curved.curve = EnvelopeExponential;
+    float level = curved.step(1.0);
+    assert(level > 0.125 + 0.05);    // rises faster than a straight line
+    for (int i = 0; i < 6; i++) level = curved.step(1.0);
+    assert(level < 1.0);
+    assert(curved.step(1.0) == 1.0); // reaches the peak on time
+    for (int i = 0; i < 8; i++) level = curved.step(1.0);
+    assert(fabs(level - 0.5) < 0.001);
+    // rendering a block matches stepping
+    for (int c = 0; c < 2; c++) {
+      ADSR a(20 * STEP_TIME, 30 * STEP_TIME, 0.5, 25 * STEP_TIME);
+      ADSR b(20 * STEP_TIME, 30 * STEP_TIME, 0.5, 25 * STEP_TIME);
+      a.curve = b.curve = c ? EnvelopeExponential : EnvelopeLinear;
+      float stepped[200], rendered[200];
+      for (int i = 0; i < 200; i++) stepped[i] = a.step((i < 100) ? 1.0 : 0.0);
+      b.render(1.0, rendered, 64);
+      b.render(1.0, rendered + 64, 36);
+      b.render(0.0, rendered + 100, 100);
+      for (int i = 0; i < 200; i++) {
+        assert(fabs(stepped[i] - rendered[i]) < 0.0001);
+      }
+    }
+    // a note released early releases from the level it reached, even when
+    //  the sustain level is the minimum
+    for (int c = 0; c < 2; c++) {
+      ADSR early(8 * STEP_TIME, 8 * STEP_TIME, 0.0, 8 * STEP_TIME);
+      early.curve = c ? EnvelopeExponential : EnvelopeLinear;
+      float last = 0.0;
+      for (int i = 0; i < 4; i++) last = early.step(1.0);
+      assert((last > 0.0) && (last < 1.0));
+      for (int i = 0; i < 8; i++) {
+        float level = early.step(0.0);
+        assert(level < last);
+        last = level;
+      }
+      early.step(0.0);
+      assert(early.step(0.0) == 0.0);
+      assert(early.phase == InitialPhase);
+    }
+    // advancing over a whole segment lands on its end like stepping does
+    for (int c = 0; c < 2; c++) {
+      ADSR jump(8 * STEP_TIME, 8 * STEP_TIME, 0.5, 8 * STEP_TIME);
+      jump.curve = c ? EnvelopeExponential : EnvelopeLinear;
+      assert(jump.advance(1.0, 8) == 1.0);
+      assert(jump._ramp == 1);
+    }
+    // a sustain level that changes every sample moves the end of the decay
+    //  without changing when it ends, and is followed once it's reached
+    for (int c = 0; c < 2; c++) {
+      ADSR swept(2 * STEP_TIME, 8 * STEP_TIME, 0.5, 2 * STEP_TIME);
+      swept.curve = c ? EnvelopeExponential : EnvelopeLinear;
+      swept.step(1.0);
+      swept.step(1.0);
+      float last = 1.0;
+      for (int i = 0; i < 8; i++) {
+        swept.sustain = 0.5 - (0.01 * i);
+        float level = swept.step(1.0);
+        assert(level < last);
+        last = level;
+      }
+      assert(last == swept.sustain);
+      swept.sustain = 0.4;
+      assert(swept.step(1.0) == swept.sustain);
+      swept.sustain = 0.3;
+      assert(swept.step(1.0) == swept.sustain);
+    }
+    // note events restart a held note and ignore the velocity
+    ADSR held(2 * STEP_TIME, 2 * STEP_TIME, 0.5, 2 * STEP_TIME);
+    held.noteOn(1.0);
+    assert(held.step(1.0) == 0.5);   // attack
+    assert(held.step(1.0) == 1.0);   // peak
+    assert(held.step(1.0) == 0.75);  // decay
+    assert(held.step(1.0) == 0.5);   // sustain
+    held.noteOn(1.0);
+    assert(held.step(1.0) == 1.0);   // retriggered attack
+    assert(held.step(0.0) == 0.75);  // decay, ignoring the velocity
+    held.noteOff();
+    assert(held.step(0.0) == 0.375); // release from the current level
+    assert(held.step(1.0) == 0.0);   // ...
+    assert(held.step(1.0) == 0.0);   // final state
+    assert(held.step(1.0) == 0.0);   // ...
   }
 };
 ///
@@ -355,34 +679,33 @@ public:
 /// a note is played.
 ///
 class AD : public Envelope {
-protected:
-  // trigger for the attack
-  RiseTrigger attackTrigger;
 public:
-  AD() : Envelope() {
-    attackTrigger.action = [&] (float v) { phase = AttackPhase; };
-  }
+  AD() : Envelope() { }
   AD(float a, float d) : AD() {
     attack = a;
     decay = d;
   }
   virtual float step(float v) {
-    attackTrigger.step(v);
+    CSYNTH_PROFILE_SCOPE(AD);
+    if (_edge(v) > 0) _enter(AttackPhase);
     // if the envelope hasn't been triggered, return nothing
-    if ((phase < AttackPhase) || (phase > DecayPhase)) return(minValue);
+    if ((phase < AttackPhase) || (phase > DecayPhase)) {
+      _ramp = -1;
+      return(minValue);
+    }
     // attack
     if (phase == AttackPhase) {
       if (attack <= 0.0) value = maxValue;
       if (value < maxValue) {
-        value += (STEP_TIME / attack) * (maxValue - minValue);
+        _advance(attack, minValue, maxValue, ENVELOPE_ATTACK_OVERSHOOT);
       }
-      else phase = DecayPhase;
+      else _enter(DecayPhase);
     }
     // decay
     if (phase == DecayPhase) {
       if (decay <= 0.0) value = minValue;
       if (value > minValue) {
-        value -= (STEP_TIME / decay) * (maxValue - minValue);
+        _advance(decay, _phaseStart, minValue, ENVELOPE_DECAY_OVERSHOOT);
       }
       else phase = InitialPhase;
     }
@@ -404,10 +727,16 @@ public:
       assert(env.step(1.0) == 0.0);  // ...
       assert(env.step(1.0) == 0.0);  // final state
     }
+    // rendering a block matches stepping
+    AD a(10 * STEP_TIME, 40 * STEP_TIME), b(10 * STEP_TIME, 40 * STEP_TIME);
+    a.curve = b.curve = EnvelopeExponential;
+    float stepped[64], rendered[64];
+    for (int i = 0; i < 64; i++) stepped[i] = a.step(1.0);
+    b.render(1.0, rendered, 64);
+    for (int i = 0; i < 64; i++) assert(fabs(stepped[i] - rendered[i]) < 0.0001);
   }
 };
 
 } // end namespace
 
 #endif
-
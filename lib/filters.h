@@ -0,0 +1,804 @@
+#ifndef CSYNTH_FILTERS_H
+#define CSYNTH_FILTERS_H
+
+#include <math.h>
+
+#include "signals.h"
+#include "control.h"
+#include "resampling.h"
+
+namespace CSynth {
+
+/// # Filters #
+///
+/// Filters shape the spectrum of a signal, for example removing high
+/// frequencies to make a sound darker. The filters below are all signal
+/// [processors](signals.h.md) that filter their source.
+///
+/// Include the following code to use the classes below:
+///
+/// ```c++
+/// #include "filters.h"
+/// using namespace CSynth;
+/// ```
+///
+/// Each filter recomputes its coefficients only when its `cutoff`, `q`, or
+/// `gain` changes, so a filter with fixed settings costs only a few
+/// multiplies per sample. Sweeping the cutoff every sample is more expensive
+/// since it involves trigonometry, so it's best to sweep at a
+/// [control rate](control.h.md) if possible.
+///
+/// The response of a filter is chosen with its `mode` property, which is one
+/// of the following values:
+///
+///  - `FilterLowPass` passes frequencies below the cutoff.
+///  - `FilterHighPass` passes frequencies above the cutoff.
+///  - `FilterBandPass` passes frequencies near the cutoff.
+///  - `FilterNotch` removes frequencies near the cutoff.
+///  - `FilterLowShelf` boosts or cuts frequencies below the cutoff by `gain`
+///    decibels (biquads only).
+///  - `FilterHighShelf` boosts or cuts frequencies above the cutoff by `gain`
+///    decibels (biquads only).
+///
+enum FilterMode {
+  FilterLowPass,
+  FilterHighPass,
+  FilterBandPass,
+  FilterNotch,
+  FilterLowShelf,
+  FilterHighShelf
+};
+
+// the coefficients of a biquad filter, normalized so a0 is 1
+typedef struct {
+  float b0, b1, b2, a1, a2;
+} BiquadCoefficients;
+
+// compute biquad coefficients using the formulas from Robert
+//  Bristow-Johnson's Audio EQ Cookbook
+static inline BiquadCoefficients biquadCoefficients(FilterMode mode,
+    float cutoff, float q, float gain) {
+  BiquadCoefficients c;
+  // keep the cutoff below the Nyquist frequency
+  float nyquist = 0.5 / Generator::sampleTime();
+  if (cutoff > nyquist * 0.99) cutoff = nyquist * 0.99;
+  if (cutoff < 1.0) cutoff = 1.0;
+  if (q < 0.01) q = 0.01;
+  float w = 2.0 * M_PI * cutoff * Generator::sampleTime();
+  float cosw = cosf(w);
+  float alpha = sinf(w) / (2.0 * q);
+  float A = powf(10.0, gain / 40.0);
+  float b0, b1, b2, a0, a1, a2;
+  switch (mode) {
+    case FilterHighPass:
+      b0 = (1.0 + cosw) / 2.0;
+      b1 = -(1.0 + cosw);
+      b2 = b0;
+      a0 = 1.0 + alpha;
+      a1 = -2.0 * cosw;
+      a2 = 1.0 - alpha;
+      break;
+    case FilterBandPass:
+      b0 = alpha;
+      b1 = 0.0;
+      b2 = -alpha;
+      a0 = 1.0 + alpha;
+      a1 = -2.0 * cosw;
+      a2 = 1.0 - alpha;
+      break;
+    case FilterNotch:
+      b0 = 1.0;
+      b1 = -2.0 * cosw;
+      b2 = 1.0;
+      a0 = 1.0 + alpha;
+      a1 = -2.0 * cosw;
+      a2 = 1.0 - alpha;
+      break;
+    case FilterLowShelf: {
+      float s = 2.0 * sqrtf(A) * alpha;
+      b0 = A * ((A + 1.0) - ((A - 1.0) * cosw) + s);
+      b1 = 2.0 * A * ((A - 1.0) - ((A + 1.0) * cosw));
+      b2 = A * ((A + 1.0) - ((A - 1.0) * cosw) - s);
+      a0 = (A + 1.0) + ((A - 1.0) * cosw) + s;
+      a1 = -2.0 * ((A - 1.0) + ((A + 1.0) * cosw));
+      a2 = (A + 1.0) + ((A - 1.0) * cosw) - s;
+      break;
+    }
+    case FilterHighShelf: {
+      float s = 2.0 * sqrtf(A) * alpha;
+      b0 = A * ((A + 1.0) + ((A - 1.0) * cosw) + s);
+      b1 = -2.0 * A * ((A - 1.0) + ((A + 1.0) * cosw));
+      b2 = A * ((A + 1.0) + ((A - 1.0) * cosw) - s);
+      a0 = (A + 1.0) - ((A - 1.0) * cosw) + s;
+      a1 = 2.0 * ((A - 1.0) - ((A + 1.0) * cosw));
+      a2 = (A + 1.0) - ((A - 1.0) * cosw) - s;
+      break;
+    }
+    case FilterLowPass:
+    default:
+      b0 = (1.0 - cosw) / 2.0;
+      b1 = 1.0 - cosw;
+      b2 = b0;
+      a0 = 1.0 + alpha;
+      a1 = -2.0 * cosw;
+      a2 = 1.0 - alpha;
+      break;
+  }
+  c.b0 = b0 / a0;
+  c.b1 = b1 / a0;
+  c.b2 = b2 / a0;
+  c.a1 = a1 / a0;
+  c.a2 = a2 / a0;
+  return(c);
+}
+
+// a base class for filters that tracks when their settings change
+class Filter : public Processor {
+protected:
+  // the settings the coefficients were last computed for
+  FilterMode _mode;
+  float _cutoff, _q, _gain;
+  // whether the settings have changed since coefficients were computed
+  bool _changed() {
+    return((mode != _mode) || (cutoff != _cutoff) ||
+           (q != _q) || (gain != _gain));
+  }
+  void _saveSettings() {
+    _mode = mode;
+    _cutoff = cutoff;
+    _q = q;
+    _gain = gain;
+  }
+public:
+  /// ## Properties ##
+  ///
+  /// The `mode` property selects the filter's response as described above.
+  FilterMode mode;
+  ///
+  /// The `cutoff` property is the cutoff or center frequency in Hertz.
+  float cutoff;
+  ///
+  /// The `q` property controls the resonance at the cutoff, where the
+  /// default of about 0.707 gives the flattest response without a peak.
+  float q;
+  ///
+  /// The `gain` property is the boost or cut in decibels for shelf filters.
+  float gain;
+  ///
+  /// ## Constructors ##
+  ///
+  /// Filters can be set up by passing a source, mode, cutoff, and q to the
+  /// constructor, or by setting properties after construction.
+  ///
+  /// ```c++
+  /// Saw osc(110.0);
+  /// Biquad filter(&osc, FilterLowPass, 800.0, 2.0);
+  /// ```
+  ///
+  Filter() : Processor() {
+    mode = FilterLowPass;
+    cutoff = 1000.0;
+    q = M_SQRT1_2;
+    gain = 0.0;
+    // start from the same settings, except for a cutoff no filter can have 
+    //  so coefficients are computed on the first step
+    _mode = mode;
+    _cutoff = -1.0;
+    _q = q;
+    _gain = gain;
+  }
+  Filter(Generator *s, FilterMode m, float f, float r = M_SQRT1_2) :
+      Filter() {
+    source = s;
+    mode = m;
+    cutoff = f;
+    q = r;
+  }
+};
+///
+/// # Biquad #
+///
+/// The `Biquad` class is a general-purpose second-order filter which can
+/// produce any of the responses listed above with a 12 dB per octave slope.
+///
+class Biquad : public Filter {
+protected:
+  BiquadCoefficients _c;
+  // the filter's state
+  float _z1, _z2;
+  void _update() {
+    if (! _changed()) return;
+    _c = biquadCoefficients(mode, cutoff, q, gain);
+    _saveSettings();
+  }
+  // filter one sample using the transposed direct form II
+  inline float _filter(float x) {
+    float y = (_c.b0 * x) + _z1;
+    _z1 = (_c.b1 * x) - (_c.a1 * y) + _z2;
+    _z2 = (_c.b2 * x) - (_c.a2 * y);
+    return(y);
+  }
+  // filter a block in place, keeping coefficients and state in registers
+  void _filterBlock(float *buffer, int count) {
+    BiquadCoefficients c = _c;
+    float z1 = _z1, z2 = _z2;
+    for (int i = 0; i < count; i++) {
+      float x = buffer[i];
+      float y = (c.b0 * x) + z1;
+      z1 = (c.b1 * x) - (c.a1 * y) + z2;
+      z2 = (c.b2 * x) - (c.a2 * y);
+      buffer[i] = y;
+    }
+    _z1 = z1;
+    _z2 = z2;
+  }
+public:
+  Biquad() : Filter() {
+    _z1 = _z2 = 0.0;
+  }
+  Biquad(Generator *s, FilterMode m, float f, float r = M_SQRT1_2) :
+      Filter(s, m, f, r) {
+    _z1 = _z2 = 0.0;
+  }
+  /// ## Methods ##
+  ///
+  /// The `step` method filters the next sample of the source, and the
+  /// `render` method filters a block of samples from the source at once,
+  /// which avoids checking the settings for every sample.
+  ///
+  virtual float step() {
+    CSYNTH_PROFILE_SCOPE(Biquad);
+    _update();
+    return(_filter(Processor::step()));
+  }
+  virtual void render(float *buffer, int count) {
+    CSYNTH_PROFILE_SCOPE(Biquad);
+    _update();
+    if (source != NULL) source->render(buffer, count);
+    else for (int i = 0; i < count; i++) buffer[i] = 0.0;
+    _filterBlock(buffer, count);
+  }
+  ///
+  /// The `process` method filters a block of samples in place, for use
+  /// without a source.
+  ///
+  void process(float *buffer, int count) {
+    CSYNTH_PROFILE_SCOPE(Biquad);
+    _update();
+    _filterBlock(buffer, count);
+  }
+  // test the biquad filter
+  static void test() {
+    DC dc;
+    dc.setRange(1.0, 1.0);
+    // a low-pass filter passes DC
+    Biquad low(&dc, FilterLowPass, 2.0);
+    for (int i = 0; i < 1000; i++) low.step();
+    assert(fabs(low.step() - 1.0) < 0.0001);
+    // a high-pass filter blocks it
+    Biquad high(&dc, FilterHighPass, 2.0);
+    for (int i = 0; i < 1000; i++) high.step();
+    assert(fabs(high.step()) < 0.0001);
+    // a low shelf boosts it
+    Biquad shelf(&dc, FilterLowShelf, 4.0);
+    shelf.gain = 6.0;
+    for (int i = 0; i < 1000; i++) shelf.step();
+    assert(fabs(shelf.step() - powf(10.0, 6.0 / 20.0)) < 0.001);
+    // rendering a block matches stepping
+    Sine osc(3.0);
+    Sine osc2(3.0);
+    Biquad a(&osc, FilterBandPass, 5.0, 2.0);
+    Biquad b(&osc2, FilterBandPass, 5.0, 2.0);
+    float block[16];
+    b.render(block, 16);
+    for (int i = 0; i < 16; i++) assert(fabs(a.step() - block[i]) < 0.00001);
+  }
+};
+///
+/// # SVF #
+///
+/// The `SVF` class is a state-variable filter built with the topology-
+/// preserving transform, which stays stable and smooth when its cutoff is
+/// swept quickly, making it a good choice for filter envelopes. It supports
+/// the low-pass, high-pass, band-pass, and notch modes.
+///
+class SVF : public Filter {
+protected:
+  // coefficients
+  float _k, _a1, _a2, _a3;
+  // the filter's state
+  float _ic1, _ic2;
+  void _update() {
+    if (! _changed()) return;
+    float f = cutoff;
+    float nyquist = 0.5 / sampleTime();
+    if (f > nyquist * 0.99) f = nyquist * 0.99;
+    if (f < 1.0) f = 1.0;
+    float g = tanf(M_PI * f * sampleTime());
+    _k = 1.0 / ((q < 0.01) ? 0.01 : q);
+    _a1 = 1.0 / (1.0 + (g * (g + _k)));
+    _a2 = g * _a1;
+    _a3 = g * _a2;
+    _saveSettings();
+  }
+  inline float _filter(float x) {
+    float v3 = x - _ic2;
+    float v1 = (_a1 * _ic1) + (_a2 * v3);
+    float v2 = _ic2 + (_a2 * _ic1) + (_a3 * v3);
+    _ic1 = (2.0 * v1) - _ic1;
+    _ic2 = (2.0 * v2) - _ic2;
+    // the low-, band-, and high-pass outputs are v2, v1, and the rest
+    switch (mode) {
+      case FilterHighPass: return(x - (_k * v1) - v2);
+      case FilterBandPass: return(v1);
+      case FilterNotch: return(x - (_k * v1));
+      default: return(v2);
+    }
+  }
+public:
+  SVF() : Filter() {
+    _ic1 = _ic2 = 0.0;
+  }
+  SVF(Generator *s, FilterMode m, float f, float r = M_SQRT1_2) :
+      Filter(s, m, f, r) {
+    _ic1 = _ic2 = 0.0;
+  }
+  virtual float step() {
+    CSYNTH_PROFILE_SCOPE(SVF);
+    _update();
+    return(_filter(Processor::step()));
+  }
+  virtual void render(float *buffer, int count) {
+    CSYNTH_PROFILE_SCOPE(SVF);
+    _update();
+    if (source != NULL) source->render(buffer, count);
+    else for (int i = 0; i < count; i++) buffer[i] = 0.0;
+    for (int i = 0; i < count; i++) buffer[i] = _filter(buffer[i]);
+  }
+  // test the state-variable filter
+  static void test() {
+    DC dc;
+    dc.setRange(1.0, 1.0);
+    SVF low(&dc, FilterLowPass, 2.0);
+    SVF high(&dc, FilterHighPass, 2.0);
+    SVF notch(&dc, FilterNotch, 2.0);
+    for (int i = 0; i < 1000; i++) {
+      low.step();
+      high.step();
+      notch.step();
+    }
+    assert(fabs(low.step() - 1.0) < 0.0001);
+    assert(fabs(high.step()) < 0.0001);
+    assert(fabs(notch.step() - 1.0) < 0.0001);
+  }
+};
+///
+/// # FilterCascade #
+///
+/// The `FilterCascade` class runs a signal through several identical biquad
+/// stages in series for a steeper slope, adding 12 dB per octave for each
+/// stage. The stages share coefficients, so they're only computed once.
+///
+/// ```c++
+/// // a 24 dB per octave low-pass filter
+/// FilterCascade filter(&osc, FilterLowPass, 800.0, 2);
+/// ```
+///
+#define FILTER_CASCADE_MAX_STAGES 8
+class FilterCascade : public Filter {
+protected:
+  BiquadCoefficients _c;
+  float _z1[FILTER_CASCADE_MAX_STAGES];
+  float _z2[FILTER_CASCADE_MAX_STAGES];
+  void _update() {
+    if (! _changed()) return;
+    _c = biquadCoefficients(mode, cutoff, q, gain);
+    _saveSettings();
+  }
+  inline float _filter(float x) {
+    for (int s = 0; s < stages; s++) {
+      float y = (_c.b0 * x) + _z1[s];
+      _z1[s] = (_c.b1 * x) - (_c.a1 * y) + _z2[s];
+      _z2[s] = (_c.b2 * x) - (_c.a2 * y);
+      x = y;
+    }
+    return(x);
+  }
+public:
+  /// The `stages` property is the number of biquads in the cascade, up to
+  /// `FILTER_CASCADE_MAX_STAGES`.
+  int stages;
+  FilterCascade() : Filter() {
+    stages = 2;
+    for (int s = 0; s < FILTER_CASCADE_MAX_STAGES; s++) _z1[s] = _z2[s] = 0.0;
+  }
+  FilterCascade(Generator *src, FilterMode m, float f, int n,
+                float r = M_SQRT1_2) : FilterCascade() {
+    source = src;
+    mode = m;
+    cutoff = f;
+    q = r;
+    stages = (n > FILTER_CASCADE_MAX_STAGES) ? FILTER_CASCADE_MAX_STAGES : n;
+  }
+  virtual float step() {
+    CSYNTH_PROFILE_SCOPE(FilterCascade);
+    _update();
+    return(_filter(Processor::step()));
+  }
+  virtual void render(float *buffer, int count) {
+    CSYNTH_PROFILE_SCOPE(FilterCascade);
+    _update();
+    if (source != NULL) source->render(buffer, count);
+    else for (int i = 0; i < count; i++) buffer[i] = 0.0;
+    for (int i = 0; i < count; i++) buffer[i] = _filter(buffer[i]);
+  }
+  // test the filter cascade
+  static void test() {
+    // two stages match two biquads in series
+    Sine osc(5.0);
+    Sine osc2(5.0);
+    FilterCascade cascade(&osc, FilterLowPass, 3.0, 2);
+    Biquad first(&osc2, FilterLowPass, 3.0);
+    Biquad second(&first, FilterLowPass, 3.0);
+    for (int i = 0; i < 64; i++) {
+      assert(fabs(cascade.step() - second.step()) < 0.00001);
+    }
+  }
+};
+///
+/// # Biquad4 #
+///
+/// The `Biquad4` class filters four signals at once using the processor's
+/// vector instructions, which costs about the same as filtering one. It's
+/// useful for patches that stack several oscillators in a voice, such as
+/// unison or chords, and each lane can have its own cutoff and q. The `step`
+/// method returns the sum of all four filtered signals, and the individual
+/// outputs are kept in the `value` array.
+///
+/// ```c++
+/// Saw osc[4];
+/// Biquad4 filter;
+/// for (int i = 0; i < 4; i++) {
+///   filter.sources[i] = &osc[i];
+///   filter.cutoff[i] = 400.0 * (i + 1);
+/// }
+/// float sample = filter.step();
+/// ```
+///
+typedef float FilterLanes __attribute__((vector_size(16)));
+class Biquad4 : public Generator {
+protected:
+  // coefficients and state for each lane
+  FilterLanes _b0, _b1, _b2, _a1, _a2;
+  FilterLanes _z1, _z2;
+  // the settings the coefficients were last computed for
+  FilterMode _mode;
+  float _cutoff[4], _q[4], _gain;
+  void _update() {
+    bool changed = (mode != _mode) || (gain != _gain);
+    for (int i = 0; i < 4; i++) {
+      if ((! changed) && (cutoff[i] == _cutoff[i]) && (q[i] == _q[i])) {
+        continue;
+      }
+      BiquadCoefficients c = biquadCoefficients(mode, cutoff[i], q[i], gain);
+      _b0[i] = c.b0;
+      _b1[i] = c.b1;
+      _b2[i] = c.b2;
+      _a1[i] = c.a1;
+      _a2[i] = c.a2;
+      _cutoff[i] = cutoff[i];
+      _q[i] = q[i];
+    }
+    _mode = mode;
+    _gain = gain;
+  }
+  inline FilterLanes _filter(FilterLanes x) {
+    FilterLanes y = (_b0 * x) + _z1;
+    _z1 = (_b1 * x) - (_a1 * y) + _z2;
+    _z2 = (_b2 * x) - (_a2 * y);
+    return(y);
+  }
+public:
+  /// ## Properties ##
+  ///
+  /// The `sources` array holds the generators to filter, any of which may
+  /// be `NULL`. The `mode` and `gain` properties apply to all lanes, while
+  /// the `cutoff` and `q` arrays set each lane separately.
+  Generator *sources[4];
+  FilterMode mode;
+  float cutoff[4];
+  float q[4];
+  float gain;
+  ///
+  /// The `value` array holds the most recent output of each lane.
+  float value[4];
+  Biquad4() : Generator() {
+    mode = _mode = FilterLowPass;
+    gain = _gain = 0.0;
+    for (int i = 0; i < 4; i++) {
+      sources[i] = NULL;
+      cutoff[i] = 1000.0;
+      q[i] = M_SQRT1_2;
+      value[i] = 0.0;
+      // make sure coefficients are computed on the first step
+      _cutoff[i] = -1.0;
+      _q[i] = q[i];
+      _z1[i] = _z2[i] = 0.0;
+    }
+  }
+  /// ## Methods ##
+  ///
+  /// The `step` method filters the next sample from each source and returns
+  /// the sum of the outputs.
+  ///
+  virtual float step() {
+    CSYNTH_PROFILE_SCOPE(Biquad4);
+    _update();
+    FilterLanes x;
+    for (int i = 0; i < 4; i++) {
+      x[i] = (sources[i] != NULL) ? pull(sources[i]) : 0.0;
+    }
+    FilterLanes y = _filter(x);
+    for (int i = 0; i < 4; i++) value[i] = y[i];
+    return(y[0] + y[1] + y[2] + y[3]);
+  }
+  ///
+  /// The `process` method filters four blocks of samples in place, one for
+  /// each lane, without using the sources.
+  ///
+  void process(float **buffers, int count) {
+    CSYNTH_PROFILE_SCOPE(Biquad4);
+    _update();
+    // keep coefficients and state in registers while writing the buffers
+    FilterLanes b0 = _b0, b1 = _b1, b2 = _b2, a1 = _a1, a2 = _a2;
+    FilterLanes z1 = _z1, z2 = _z2;
+    FilterLanes x, y = z1;
+    float *in0 = buffers[0], *in1 = buffers[1];
+    float *in2 = buffers[2], *in3 = buffers[3];
+    for (int n = 0; n < count; n++) {
+      x = (FilterLanes){ in0[n], in1[n], in2[n], in3[n] };
+      y = (b0 * x) + z1;
+      z1 = (b1 * x) - (a1 * y) + z2;
+      z2 = (b2 * x) - (a2 * y);
+      in0[n] = y[0];
+      in1[n] = y[1];
+      in2[n] = y[2];
+      in3[n] = y[3];
+    }
+    _z1 = z1;
+    _z2 = z2;
+    for (int i = 0; i < 4; i++) value[i] = y[i];
+  }
+  // test the four-lane filter
+  static void test() {
+    Sine osc[4];
+    Sine ref[4];
+    Biquad single[4];
+    Biquad4 wide;
+    for (int i = 0; i < 4; i++) {
+      osc[i].frequency = ref[i].frequency = 1.0 + i;
+      wide.sources[i] = &osc[i];
+      wide.cutoff[i] = single[i].cutoff = 2.0 + i;
+      wide.q[i] = single[i].q = 1.0 + (i * 0.5);
+      single[i].source = &ref[i];
+    }
+    // each lane matches a separate biquad
+    for (int n = 0; n < 64; n++) {
+      wide.step();
+      for (int i = 0; i < 4; i++) {
+        assert(fabs(wide.value[i] - single[i].step()) < 0.00001);
+      }
+    }
+  }
+};
+
+///
+/// # Ladder #
+///
+/// The `Ladder` class models the classic four-pole transistor ladder
+/// low-pass filter, with a 24 dB per octave slope and resonance that can be
+/// turned up until it self-oscillates. It's solved without a delay in the
+/// feedback path so it stays in tune at high cutoffs, and saturates its
+/// input like the analog circuit.
+///
+/// To keep it cheap enough to run on every voice, the saturation uses a
+/// rational approximation of `tanh` (see `fastTanh` below), and the cutoff
+/// is only converted to a filter coefficient at [control rate](control.h.md)
+/// and interpolated in between, so it can be swept every sample for about
+/// the same cost as leaving it fixed.
+///
+/// ```c++
+/// Saw osc(110.0);
+/// Ladder filter(&osc, 800.0, 0.5);
+/// float sample = filter.step();
+/// ```
+///
+class Ladder : public Processor {
+protected:
+  // the state of each one-pole stage
+  float _s[4];
+  // the current coefficient, and its change per sample while interpolating
+  float _g, _gStep;
+  // the number of samples left to interpolate the coefficient over
+  int _remaining;
+  // the settings the coefficient was last computed for
+  float _cutoff;
+  int _oversample;
+  // converters for oversampling
+  HalfbandUpsampler _up;
+  HalfbandDownsampler _down;
+  // get the coefficient for the current cutoff
+  float _coefficient() {
+    float f = cutoff;
+    float nyquist = 0.5 / sampleTime();
+    if (f > nyquist * 0.9) f = nyquist * 0.9;
+    if (f < 1.0) f = 1.0;
+    return(tanf(M_PI * f * sampleTime() / (float)_oversample));
+  }
+  // move the coefficient toward the current cutoff
+  inline void _updateCutoff() {
+    if (_remaining > 0) {
+      _g += _gStep;
+      _remaining--;
+      return;
+    }
+    if ((cutoff == _cutoff) && (oversample == _oversample)) return;
+    // jump to a new oversampling rate, since the old coefficient is invalid
+    bool jump = ((oversample != _oversample) || (_cutoff < 0.0));
+    _cutoff = cutoff;
+    _oversample = (oversample == 2) ? 2 : 1;
+    float g = _coefficient();
+    if ((jump) || (interval <= 1)) _g = g;
+    else {
+      _gStep = (g - _g) / (float)interval;
+      _remaining = interval;
+    }
+  }
+  inline float _saturate(float x) {
+    return(exact ? tanhf(x) : fastTanh(x));
+  }
+  // filter one sample at the internal rate
+  inline float _filter(float x) {
+    float g = _g;
+    float G = g / (1.0f + g);
+    // solve for the input to the first stage given the feedback from the
+    //  last stage, which depends on it through all four stages
+    float S = ((G * G * G * _s[0]) + (G * G * _s[1]) + (G * _s[2]) + _s[3]) / 
+              (1.0f + g);
+    float k = 4.0f * resonance;
+    float G4 = G * G * G * G;
+    float u = _saturate(drive * (x - (k * S)) / (1.0f + (k * G4)));
+    // run the stages
+    for (int i = 0; i < 4; i++) {
+      float v = (u - _s[i]) * G;
+      float y = v + _s[i];
+      _s[i] = y + v;
+      u = y;
+    }
+    return(u);
+  }
+  inline float _process(float x) {
+    _updateCutoff();
+    if (_oversample == 2) {
+      float fast[2];
+      _up.process(x, fast);
+      fast[0] = _filter(fast[0]);
+      fast[1] = _filter(fast[1]);
+      return(_down.process(fast));
+    }
+    return(_filter(x));
+  }
+public:
+  /// ## Properties ##
+  ///
+  /// The `cutoff` property is the cutoff frequency in Hertz.
+  float cutoff;
+  ///
+  /// The `resonance` property is the amount of feedback, where 0.0 gives no
+  /// peak at the cutoff and 1.0 makes the filter self-oscillate. As in the
+  /// analog circuit, adding resonance reduces the level of low frequencies.
+  float resonance;
+  ///
+  /// The `drive` property is the gain applied before saturation, where
+  /// higher values distort more.
+  float drive;
+  ///
+  /// The `interval` property is the number of samples between updates of 
+  /// the cutoff, which defaults to `CONTROL_INTERVAL`. Set it to 1 to 
+  /// update on every sample.
+  int interval;
+  ///
+  /// The `oversample` property can be set to 2 to run the filter at twice
+  /// the sample rate, which reduces aliasing from the saturation when the
+  /// filter is driven hard, at about three times the cost and 7 samples
+  /// of latency.
+  int oversample;
+  ///
+  /// The `exact` property makes the filter use the library `tanh` function,
+  /// which is much slower and mainly useful for comparison.
+  bool exact;
+  ///
+  /// ## Constructors ##
+  ///
+  /// A ladder filter can be made with a source, cutoff, and resonance.
+  ///
+  Ladder() : Processor() {
+    for (int i = 0; i < 4; i++) _s[i] = 0.0;
+    _g = _gStep = 0.0;
+    _remaining = 0;
+    _cutoff = -1.0;
+    _oversample = 1;
+    cutoff = 1000.0;
+    resonance = 0.0;
+    drive = 1.0;
+    interval = CONTROL_INTERVAL;
+    oversample = 1;
+    exact = false;
+  }
+  Ladder(Generator *s, float f, float r = 0.0) : Ladder() {
+    source = s;
+    cutoff = f;
+    resonance = r;
+  }
+  /// ## Methods ##
+  ///
+  /// The `step` method filters the next sample of the source, and `render`
+  /// filters a block of samples from it.
+  ///
+  virtual float step() {
+    CSYNTH_PROFILE_SCOPE(Ladder);
+    return(_process(Processor::step()));
+  }
+  virtual void render(float *buffer, int count) {
+    CSYNTH_PROFILE_SCOPE(Ladder);
+    if (source != NULL) source->render(buffer, count);
+    else for (int i = 0; i < count; i++) buffer[i] = 0.0;
+    for (int i = 0; i < count; i++) buffer[i] = _process(buffer[i]);
+  }
+  ///
+  /// The `fastTanh` method approximates `tanh` with a rational function
+  /// that matches it closely for small inputs and reaches exactly 1.0 at 3.0,
+  /// staying within about 2% everywhere.
+  ///
+  static inline float fastTanh(float x) {
+    if (x > 3.0f) return(1.0f);
+    if (x < -3.0f) return(-1.0f);
+    float x2 = x * x;
+    return(x * (27.0f + x2) / (27.0f + (9.0f * x2)));
+  }
+  // test the ladder filter
+  static void test() {
+    // the approximation stays close to tanh
+    for (float x = -5.0; x <= 5.0; x += 0.01) {
+      assert(fabs(fastTanh(x) - tanh(x)) < 0.025);
+    }
+    DC dc;
+    dc.setRange(0.01, 0.01);
+    // low frequencies pass at a level that falls with resonance
+    Ladder open(&dc, 4.0);
+    Ladder resonant(&dc, 4.0, 0.5);
+    Ladder oversampled(&dc, 4.0);
+    oversampled.oversample = 2;
+    for (int i = 0; i < 1000; i++) {
+      open.step();
+      resonant.step();
+      oversampled.step();
+    }
+    assert(fabs(open.step() - 0.01) < 0.0001);
+    assert(fabs(resonant.step() - (0.01 / 3.0)) < 0.0001);
+    assert(fabs(oversampled.step() - 0.01) < 0.0001);
+    // the cutoff moves to a new value over one interval
+    Ladder sweep(&dc, 4.0);
+    sweep.interval = 4;
+    sweep.step();
+    sweep.cutoff = 8.0;
+    sweep.step();
+    assert(sweep._g < tanf(M_PI * 8.0 * STEP_TIME));
+    for (int i = 0; i < 4; i++) sweep.step();
+    assert(fabs(sweep._g - tanf(M_PI * 8.0 * STEP_TIME)) < 0.00001);
+  }
+};
+
+} // end namespace
+
+#endif
@@ -4,8 +4,48 @@
 #include <math.h>
 #include <stdlib.h>
 
+#include "arena.h"
+#include "profile.h"
+
 namespace CSynth {
 
+// patches built without a fixed STEP_TIME take the time between samples 
+//  from the plugin when a context is made, so one build can run at any 
+//  sample rate, while a fixed STEP_TIME lets the compiler fold it into 
+//  constants; the plugin fixes it for common rates, since reading it at 
+//  run time is measurably slower (compare the two builds in `make bench`)
+#ifndef STEP_TIME
+#define CSYNTH_RUNTIME_STEP_TIME
+#define STEP_TIME (CSynth::currentStepTime())
+#endif
+
+// the time in seconds between samples for generators on this thread
+static inline double &currentStepTime() {
+  static thread_local double time = 1.0 / 48000.0;
+  return(time);
+}
+
+// make a step time current until the end of the enclosing block, which 
+//  only has an effect when STEP_TIME isn't fixed
+class StepTimeScope {
+protected:
+  double previous;
+public:
+  StepTimeScope(double time) {
+    previous = currentStepTime();
+    currentStepTime() = time;
+  }
+  ~StepTimeScope() {
+    currentStepTime() = previous;
+  }
+};
+
+// the number of oversampled sections being stepped on any thread; the step
+//  scale is per thread, but this is read on every step so that it only has
+//  to be looked up while some thread is oversampling, using builtins that 
+//  stay inline in patches built without optimization
+static int _oversampling = 0;
+
 /// # Generators #
 ///
 /// A generator emits some kind of time-based signal. Generators form the basis 
@@ -51,10 +91,33 @@ public:
     minValue = vmin;
     maxValue = vmax;
   }
+  ///  The `setProfileName` method names the generator in
+  ///  [profiling](profile.h.md) reports. It does nothing unless the patch 
+  ///  is built with profiling turned on.
+  ///
+  void setProfileName(const char *name) {
+#ifdef CSYNTH_PROFILE
+    profileCounter = ProfileCounter::named(name, false);
+#endif
+  }
+#ifdef CSYNTH_PROFILE
+  // the counter for this instance's name, if it has one
+  ProfileCounter *profileCounter;
+#endif
   Generator() {
     minValue = -1.0;
     maxValue = 1.0;
+    _steps = 1;
+#ifdef CSYNTH_PROFILE
+    profileCounter = NULL;
+#endif
   }
+  // allocate generators from the current arena if there is one, so the 
+  //  modules of a voice are laid out together
+  static void *operator new(size_t size) { return(arenaAllocate(size)); }
+  static void *operator new[](size_t size) { return(arenaAllocate(size)); }
+  static void operator delete(void *p) { arenaFree(p); }
+  static void operator delete[](void *p) { arenaFree(p); }
   /// ## Methods ##
   /// 
   /// In general, calling a generator's `step` method will return a single 
@@ -70,6 +133,68 @@ public:
   /// ```
   ///
   virtual float step() { return(0.0); }
+  ///
+  /// The `render` method fills a buffer with the given number of samples.
+  /// This is the same as calling `step` for each one, but some generators 
+  /// like [filters](filters.h.md) can do less work per sample in a block.
+  ///
+  /// ```c++
+  /// Sine note(440.0);
+  /// float signal[100];
+  /// note.render(signal, 100);
+  /// ```
+  ///
+  virtual void render(float *buffer, int count) {
+    for (int i = 0; i < count; i++) buffer[i] = step();
+  }
+  ///
+  /// The `advance` method returns one sample like `step`, but moves the
+  /// generator forward by the given number of samples instead of one. This
+  /// lets slowly-changing signals like LFOs and envelopes be evaluated at a
+  /// [control rate](control.h.md) rather than every sample. Generators with
+  /// time-based state scale it by the number of samples, and processors pass
+  /// the same number on to their sources.
+  ///
+  /// ```c++
+  /// Sine lfo(4.0);
+  /// float sample = lfo.advance(16); // the same phase as 16 calls to step
+  /// ```
+  ///
+  virtual float advance(int samples) {
+    _steps = samples;
+    float value = step();
+    _steps = 1;
+    return(value);
+  }
+  ///
+  /// The static `sampleTime` method returns the time in seconds between
+  /// samples at the rate generators are currently being stepped. This is
+  /// `STEP_TIME` except inside an [oversampled](resampling.h.md) section,
+  /// and classes that compute coefficients from a frequency use it so they
+  /// work at either rate.
+  ///
+  static double sampleTime() { return(STEP_TIME * currentStepScale()); }
+protected:
+  // the number of samples the current step covers, which is more than one
+  //  while the generator is being advanced
+  int _steps;
+  // the fraction of a sample each step covers on this thread, which is less
+  //  than one while an oversampled section is being stepped
+  static double &stepScale() {
+    static thread_local double scale = 1.0;
+    return(scale);
+  }
+  // get the step scale without looking it up when nothing is oversampled
+  static double currentStepScale() {
+    return((__atomic_load_n(&_oversampling, __ATOMIC_RELAXED) > 0) ? 
+      stepScale() : 1.0);
+  }
+  // get the time covered by the current step in seconds
+  double stepTime() { return(STEP_TIME * _steps * currentStepScale()); }
+  // get a sample from a source covering the same time as the current step
+  float pull(Generator *g) {
+    return((_steps > 1) ? g->advance(_steps) : g->step());
+  }
 };
 ///
 /// # DC #
@@ -101,6 +226,7 @@ class WhiteNoise : public Generator {
 public:
   WhiteNoise() : Generator() { }
   virtual float step() {
+    CSYNTH_PROFILE_SCOPE(WhiteNoise);
     return(minValue + 
       (((float)rand() / RAND_MAX) * (maxValue - minValue)));
   }
@@ -158,6 +284,7 @@ protected:
     }
   }
   virtual float step() {
+    CSYNTH_PROFILE_SCOPE(PinkNoise);
     float newRandomValue = 0;
     // increment the counter
     counter = (counter + 1) & maxCounter;
@@ -218,6 +345,7 @@ protected:
     sum = maxSum / 2.0;
   }
   virtual float step() {
+    CSYNTH_PROFILE_SCOPE(BrownNoise);
     float r;
     // choose a random offset from the current value that keeps us within 
     // a given range
@@ -0,0 +1,469 @@
+#ifndef CSYNTH_HOST_H
+#define CSYNTH_HOST_H
+
+#include <new>
+#include <type_traits>
+
+#include "arena.h"
+#include "profile.h"
+
+/// # Patch Host #
+///
+/// This file connects a patch to the plugin. It's included automatically
+/// after the patch code when the plugin builds a patch, so patches should
+/// not include it themselves.
+///
+/// Every patch must define a `Voice` class, and the plugin makes one
+/// instance of it for each voice of polyphony. For each sample, the plugin
+/// calls its `step` method with the frequency and velocity of the note the
+/// voice is playing and an array of controller values, then adds up the
+/// outputs of all the voices.
+///
+/// Controller values change smoothly, with the plugin ramping each new 
+/// value in over a few milliseconds so that voices don't need to smooth 
+/// them themselves. A voice that would rather work on a block of samples at 
+/// a time may define a `render` method, which is passed the controller values 
+/// for every sample of the block. The values for sample `i` start at 
+/// `cv + (i * CV_COUNT)`:
+///
+/// ```c++
+/// class Voice {
+///   public:
+///   Sine osc;
+///   void render(float *buffer, int count, float f, float v, float *cv) {
+///     osc.frequency = f;
+///     for (int i = 0; i < count; i++) {
+///       buffer[i] = osc.step() * v * cv[(i * CV_COUNT) + 1];
+///     }
+///   }
+/// };
+/// ```
+///
+/// Voices can also be told directly when notes start and stop, rather than
+/// watching for the velocity to change. If the `Voice` class has a `noteOn`
+/// method taking the velocity, it's called when the voice is given a note,
+/// including when it takes over from a note that was still held, which a 
+/// change of velocity alone might not reveal. A `noteOff` method is called
+/// when the note is released. A `noteOn` method may also take a second 
+/// argument, which is true when the voice was still holding a note. The 
+/// plugin still passes the velocity to `step` or `render` as usual, and
+/// [envelopes](envelopes.h.md) have matching methods to pass events on to:
+///
+/// ```c++
+/// class Voice {
+///   public:
+///   Sine osc;
+///   ADSR env;
+///   void noteOn(float v) { env.noteOn(v); }
+///   void noteOff() { env.noteOff(); }
+///   float step(float f, float v, float *cv) {
+///     return(osc.step(f) * env.step());
+///   }
+/// };
+/// ```
+///
+/// A patch may also define a `Modulators` class derived from 
+/// [ModulatorBank](modulators.h.md) to hold LFOs shared by all voices. 
+/// There's one per context, and it's evaluated once for each block before 
+/// the voices are rendered. If the `Voice` class has a constructor that 
+/// takes a pointer to the `Modulators`, it will be passed the context's bank.
+///
+/// Voices aren't global, so one compiled patch can be used by any number of
+/// plugin instances. Each instance gets its own context holding only as many
+/// voices as its polyphony calls for, laid out next to each other in memory.
+/// This means a `Voice` needs a default constructor, and shouldn't keep state
+/// in static or global variables that other voices or instances would share.
+/// When polyphony is raised, the extra voices are made next to each other in
+/// a block of their own, so voices that are already playing carry on without
+/// being disturbed.
+///
+/// Each context also has an [arena](arena.h.md) that's current while its
+/// voices and master section are constructed, so any generators they make
+/// with `new` are kept together with the rest of the voice and released
+/// along with the context.
+///
+/// A patch may also define a `Master` class to process the summed output
+/// of all voices. There is only one instance of it, so it's the place for
+/// effects like echo or reverb that would be wasteful to run on every voice.
+/// The class may define a `step` method that takes one sample of the mix
+/// and the controller values and returns the processed sample:
+///
+/// ```c++
+/// class Master {
+///   public:
+///   float step(float in, float *cv) {
+///     return(in * 0.5);
+///   }
+/// };
+/// ```
+///
+/// Alternately it may define a `render` method that processes a whole block
+/// of samples in place, which will be used instead of `step` if present.
+/// Like a voice's `render` method, it's passed the controller values for 
+/// every sample of the block, with the values for sample `i` starting at 
+/// `cv + (i * CV_COUNT)`:
+///
+/// ```c++
+/// class Master {
+///   public:
+///   void render(float *buffer, int count, float *cv) {
+///     for (int i = 0; i < count; i++) {
+///       buffer[i] *= cv[(i * CV_COUNT) + 1];
+///     }
+///   }
+/// };
+/// ```
+///
+
+// declare the master section and modulators in case the patch doesn't 
+//  define them
+class Master;
+class Modulators;
+
+namespace CSynth {
+
+// detect whether a type has been defined
+template <typename T, typename = void>
+struct IsComplete : std::false_type { };
+template <typename T>
+struct IsComplete<T, decltype(void(sizeof(T)))> : std::true_type { };
+
+// detect whether a master section has a block rendering method
+template <typename T, typename = void>
+struct HasRender : std::false_type { };
+template <typename T>
+struct HasRender<T, decltype(std::declval<T&>().render(
+  (float *)NULL, 0, (float *)NULL))> : std::true_type { };
+
+// detect whether a voice has a block rendering method
+template <typename T, typename = void>
+struct HasVoiceRender : std::false_type { };
+template <typename T>
+struct HasVoiceRender<T, decltype(std::declval<T&>().render(
+  (float *)NULL, 0, 0.0f, 0.0f, (float *)NULL))> : std::true_type { };
+
+// detect whether a voice has a step method
+template <typename T, typename = void>
+struct HasVoiceStep : std::false_type { };
+template <typename T>
+struct HasVoiceStep<T, decltype(void(std::declval<T&>().step(
+  0.0f, 0.0f, (float *)NULL)))> : std::true_type { };
+
+// detect which note event methods a voice has
+template <typename T, typename = void>
+struct HasNoteOn : std::false_type { };
+template <typename T>
+struct HasNoteOn<T, decltype(void(std::declval<T&>().noteOn(0.0f)))> 
+  : std::true_type { };
+template <typename T, typename = void>
+struct HasRetrigger : std::false_type { };
+template <typename T>
+struct HasRetrigger<T, 
+  decltype(void(std::declval<T&>().noteOn(0.0f, true)))> : std::true_type { };
+template <typename T, typename = void>
+struct HasNoteOff : std::false_type { };
+template <typename T>
+struct HasNoteOff<T, decltype(void(std::declval<T&>().noteOff()))> 
+  : std::true_type { };
+
+// tell a voice a note started, if it wants to know, preferring the method
+//  that says whether it was a retrigger
+template <typename T, typename H>
+void noteOnVoice(T &voice, float v, bool retrigger, std::true_type, H) {
+  voice.noteOn(v, retrigger);
+}
+template <typename T>
+void noteOnVoice(T &voice, float v, bool retrigger, std::false_type, 
+                 std::true_type) {
+  voice.noteOn(v);
+}
+template <typename T>
+void noteOnVoice(T &voice, float v, bool retrigger, std::false_type, 
+                 std::false_type) { }
+
+// tell a voice its note was released, if it wants to know
+template <typename T>
+void noteOffVoice(T &voice, std::true_type) {
+  voice.noteOff();
+}
+template <typename T>
+void noteOffVoice(T &voice, std::false_type) { }
+
+// get one sample from a voice, rendering a block of one sample if it has 
+//  no step method
+template <typename T>
+float stepVoice(T &voice, float f, float v, float *cv, std::true_type) {
+  return(voice.step(f, v, cv));
+}
+template <typename T>
+float stepVoice(T &voice, float f, float v, float *cv, std::false_type) {
+  float sample;
+  voice.render(&sample, 1, f, v, cv);
+  return(sample);
+}
+
+// render a block of samples from a voice, stepping it if it has no 
+//  rendering method of its own
+template <typename T, typename M>
+void renderVoice(T &voice, M &modulators, float *buffer, int count, 
+                 float f, float v, float *cv, std::true_type) {
+  modulators.setIndex(0);
+  voice.render(buffer, count, f, v, cv);
+}
+template <typename T, typename M>
+void renderVoice(T &voice, M &modulators, float *buffer, int count, 
+                 float f, float v, float *cv, std::false_type) {
+  for (int i = 0; i < count; i++) {
+    // let shared modulators know which sample is being stepped
+    modulators.setIndex(i);
+    buffer[i] = stepVoice(voice, f, v, cv + (i * CV_COUNT), 
+                          HasVoiceStep<T>());
+  }
+}
+
+// construct a voice, passing it the modulator bank if it takes one
+template <typename T, typename M>
+void makeVoice(T *voice, M *modulators, std::true_type) {
+  new (voice) T(modulators);
+}
+template <typename T, typename M>
+void makeVoice(T *voice, M *modulators, std::false_type) {
+  new (voice) T();
+}
+
+// evaluate the patch's shared modulators, if it has any
+template <typename T, bool defined = IsComplete<T>::value>
+class ModulatorSection {
+public:
+  T *bank() { return(NULL); }
+  void render(int count) { }
+  void setIndex(int i) { }
+};
+template <typename T>
+class ModulatorSection<T, true> {
+protected:
+  T modulators;
+public:
+  T *bank() { return(&modulators); }
+  void render(int count) { modulators.render(count); }
+  void setIndex(int i) { modulators.index = i; }
+};
+
+// run the patch's master section on a block of samples, if it has one
+template <typename T, bool defined = IsComplete<T>::value>
+class MasterSection {
+public:
+  void render(float *buffer, int count, float *cv) { }
+};
+template <typename T>
+class MasterSection<T, true> {
+protected:
+  T master;
+  void _render(float *buffer, int count, float *cv, std::true_type) {
+    master.render(buffer, count, cv);
+  }
+  void _render(float *buffer, int count, float *cv, std::false_type) {
+    for (int i = 0; i < count; i++) {
+      buffer[i] = master.step(buffer[i], cv + (i * CV_COUNT));
+    }
+  }
+public:
+  void render(float *buffer, int count, float *cv) {
+    _render(buffer, count, cv, HasRender<T>());
+  }
+};
+
+// a set of voices made for a context, with everything they allocate while 
+//  being constructed kept in their own arena
+class VoiceBlock {
+public:
+  Arena arena;
+  // the index of the first voice in the context and the number of voices
+  int first;
+  int count;
+  Voice *voices;
+  // pointers to all the voices of the context once the block is attached
+  Voice **table;
+  // the block attached to the context before this one
+  VoiceBlock *next;
+  // make voices after the given ones, running each for the given number of
+  //  samples so they're ready before they're heard
+  VoiceBlock(Voice **previous, int n, int c, Modulators *bank, double t,
+             int warmUp) {
+    ArenaScope scope(&arena);
+    StepTimeScope timeScope(t);
+    first = n;
+    count = c;
+    next = NULL;
+    table = (Voice **)arena.allocate(sizeof(Voice *) * (first + count));
+    for (int i = 0; i < first; i++) table[i] = previous[i];
+    // allocate all voices in a single block, then construct them in order 
+    //  so each voice's modules follow the ones before it
+    voices = (Voice *)arena.allocate(sizeof(Voice) * count);
+    for (int i = 0; i < count; i++) {
+      makeVoice(&voices[i], bank, 
+                std::is_constructible<Voice, Modulators *>());
+      table[first + i] = &voices[i];
+    }
+    float cv[CV_COUNT];
+    for (int i = 0; i < CV_COUNT; i++) cv[i] = 0.0;
+    for (int i = 0; i < count; i++) {
+      for (int j = 0; j < warmUp; j++) {
+        stepVoice(voices[i], 440.0, 0.0, cv, HasVoiceStep<Voice>());
+      }
+    }
+  }
+  ~VoiceBlock() {
+    for (int i = count - 1; i >= 0; i--) {
+      voices[i].~Voice();
+    }
+    // the arena's memory is released when it's destroyed
+  }
+};
+
+// the state of one plugin instance using the patch, with everything it 
+//  allocates while being constructed kept in its arena
+class PatchContext {
+public:
+  Arena arena;
+  int polyphony;
+  Voice **voices;
+  MasterSection<Master> *master;
+  ModulatorSection<Modulators> *modulators;
+  // the blocks the voices are in, newest first
+  VoiceBlock *blocks;
+  // the time in seconds between samples, used unless STEP_TIME is fixed
+  double stepTime;
+  PatchContext(int n, double t) {
+    ArenaScope scope(&arena);
+    StepTimeScope timeScope(t);
+    stepTime = t;
+    // make the shared modulators first so voices can be given them
+    modulators = new (arena.allocate(sizeof(ModulatorSection<Modulators>)))
+      ModulatorSection<Modulators>();
+    blocks = new VoiceBlock(NULL, 0, n, modulators->bank(), t, 0);
+    voices = blocks->table;
+    polyphony = n;
+    master = new (arena.allocate(sizeof(MasterSection<Master>))) 
+      MasterSection<Master>();
+  }
+  ~PatchContext() {
+    master->~MasterSection<Master>();
+    while (blocks != NULL) {
+      VoiceBlock *block = blocks;
+      blocks = block->next;
+      delete block;
+    }
+    modulators->~ModulatorSection<Modulators>();
+    // the arena's memory is released when it's destroyed
+  }
+  // make the voices needed to reach the given polyphony without changing 
+  //  the context, so it can keep running while they're made
+  VoiceBlock *grow(int n, int warmUp) {
+    if (n <= polyphony) return(NULL);
+    return(new VoiceBlock(voices, polyphony, n - polyphony, 
+                          modulators->bank(), stepTime, warmUp));
+  }
+  // add voices made by grow, leaving the existing ones as they are
+  void attach(VoiceBlock *block) {
+    block->next = blocks;
+    blocks = block;
+    voices = block->table;
+    polyphony = block->first + block->count;
+  }
+  // make the context's step time current before running it, since other
+  //  instances on the same thread may use a different sample rate
+  inline void makeCurrent() {
+#ifdef CSYNTH_RUNTIME_STEP_TIME
+    currentStepTime() = stepTime;
+#endif
+  }
+};
+
+} // end namespace
+
+// make a context with the given number of voices, running with the given
+//  time in seconds between samples
+extern "C" void *ext_create(int polyphony, double step_time) {
+  return(new CSynth::PatchContext(polyphony, step_time));
+}
+
+extern "C" void ext_destroy(void *ctx) {
+  delete (CSynth::PatchContext *)ctx;
+}
+
+// make the voices a context needs to reach the given polyphony, running each
+//  for the given number of samples, or return NULL if it has enough already
+extern "C" void *ext_grow(void *ctx, int polyphony, int warm_up) {
+  CSynth::PatchContext *context = (CSynth::PatchContext *)ctx;
+  return(context->grow(polyphony, warm_up));
+}
+
+// add voices made by ext_grow to the context they were made for, which 
+//  doesn't change the voices it already has
+extern "C" void ext_attach(void *ctx, void *voices) {
+  CSynth::PatchContext *context = (CSynth::PatchContext *)ctx;
+  context->attach((CSynth::VoiceBlock *)voices);
+}
+
+// destroy voices made by ext_grow that were never attached
+extern "C" void ext_release(void *voices) {
+  delete (CSynth::VoiceBlock *)voices;
+}
+
+extern "C" float ext_step(void *ctx, int voice, float f, float v, float *cv) {
+  CSynth::PatchContext *context = (CSynth::PatchContext *)ctx;
+  context->makeCurrent();
+  Voice &target = *(context->voices[voice]);
+  return(CSynth::stepVoice(target, f, v, cv, CSynth::HasVoiceStep<Voice>()));
+}
+
+// render a block of samples from a voice, where cv holds count sets of
+//  controller values, one for each sample
+extern "C" void ext_render(void *ctx, int voice, float f, float v, float *cv, 
+                           float *buffer, int count) {
+  CSynth::PatchContext *context = (CSynth::PatchContext *)ctx;
+  context->makeCurrent();
+  CSynth::renderVoice(*(context->voices[voice]), *(context->modulators), 
+                      buffer, count, f, v, cv, 
+                      CSynth::HasVoiceRender<Voice>());
+}
+
+// evaluate the shared modulators for a block of the given number of samples
+extern "C" void ext_modulate(void *ctx, int count) {
+  CSynth::PatchContext *context = (CSynth::PatchContext *)ctx;
+  context->makeCurrent();
+  context->modulators->render(count);
+}
+
+// tell a voice it's starting a note, where retrigger is nonzero if it was
+//  still holding another one
+extern "C" void ext_note_on(void *ctx, int voice, float v, int retrigger) {
+  CSynth::PatchContext *context = (CSynth::PatchContext *)ctx;
+  context->makeCurrent();
+  CSynth::noteOnVoice(*(context->voices[voice]), v, retrigger != 0, 
+                      CSynth::HasRetrigger<Voice>(), CSynth::HasNoteOn<Voice>());
+}
+
+// tell a voice its note was released
+extern "C" void ext_note_off(void *ctx, int voice) {
+  CSynth::PatchContext *context = (CSynth::PatchContext *)ctx;
+  context->makeCurrent();
+  CSynth::noteOffVoice(*(context->voices[voice]), CSynth::HasNoteOff<Voice>());
+}
+
+// process a block of the mix of all voices in place, where cv holds count 
+//  sets of controller values, one for each sample
+extern "C" void ext_master(void *ctx, float *buffer, int count, float *cv) {
+  CSynth::PatchContext *context = (CSynth::PatchContext *)ctx;
+  context->makeCurrent();
+  context->master->render(buffer, count, cv);
+}
+
+#ifdef CSYNTH_PROFILE
+extern "C" int ext_profile_report(char *buffer, int size) {
+  return(CSynth::profileReport(buffer, size));
+}
+#endif
+
+#endif
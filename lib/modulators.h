@@ -0,0 +1,258 @@
+#ifndef CSYNTH_MODULATORS_H
+#define CSYNTH_MODULATORS_H
+
+#include "oscillators.h"
+
+namespace CSynth {
+
+/// # Modulator Bank #
+///
+/// LFOs that run at a fixed rate produce the same signal in every voice, so
+/// giving each voice its own copy multiplies their cost by the polyphony
+/// for no benefit. A patch can instead define a `Modulators` class holding
+/// shared modulators, which the plugin evaluates once for each block of
+/// samples before rendering the voices. All voices can then read its
+/// outputs.
+///
+/// Include the following code to use the classes below:
+///
+/// ```c++
+/// #include "modulators.h"
+/// using namespace CSynth;
+/// ```
+///
+/// To use the bank, derive the `Modulators` class from `ModulatorBank`, add
+/// each modulator to it, and give the `Voice` class a constructor that takes
+/// a pointer to it:
+///
+/// ```c++
+/// class Modulators : public ModulatorBank {
+///   public:
+///   SharedLFO vibrato;
+///   Modulators() : vibrato(Sine(), 5.0) {
+///     add(&vibrato);
+///   }
+/// };
+///
+/// class Voice {
+///   public:
+///   Modulators *mod;
+///   Sine osc;
+///   Voice(Modulators *m) {
+///     mod = m;
+///   }
+///   float step(float f, float v, float *cv) {
+///     return(osc.step(f * (1.0 + (mod->vibrato.value() * 0.01))) * v);
+///   }
+/// };
+/// ```
+///
+
+// the most samples a modulator bank can be evaluated for at once
+#define MODULATOR_BLOCK_LEN 64
+// the most modulators a bank can hold
+#define MODULATOR_BANK_LEN 16
+// the number of points in the table a shared LFO's shape is stored in
+#define SHARED_LFO_TABLE_LEN 256
+
+class ModulatorBank;
+///
+/// # SharedLFO #
+///
+/// The `SharedLFO` class is a free-running low-frequency oscillator shared
+/// by all voices. Its shape is copied from an oscillator when it's made,
+/// and its phase advances once per sample no matter how many voices read it.
+///
+class SharedLFO {
+protected:
+  // one cycle of the waveform, with the first point repeated at the end
+  float _table[SHARED_LFO_TABLE_LEN + 1];
+  // the phase and value for each sample of the current block
+  float _phases[MODULATOR_BLOCK_LEN];
+  float _values[MODULATOR_BLOCK_LEN];
+  // the bank that tracks which sample is being read
+  ModulatorBank *_bank;
+  // look up the waveform at a phase from 0.0 to 1.0
+  float _lookup(float p) {
+    float x = p * SHARED_LFO_TABLE_LEN;
+    int i = (int)x;
+    float mix = x - (float)i;
+    return((_table[i] * (1.0 - mix)) + (_table[i + 1] * mix));
+  }
+public:
+  /// ## Properties ##
+  ///
+  /// The `frequency` property is the rate of the LFO in Hertz, and `phase`
+  /// is its current phase from 0.0 to 1.0.
+  float frequency;
+  float phase;
+  ///
+  /// The `minValue` and `maxValue` properties are the range of the output,
+  /// which starts out the same as the oscillator it was made from. Use the 
+  /// `setRange` method to change them.
+  float minValue, maxValue;
+  ///
+  /// ## Constructors ##
+  ///
+  /// A shared LFO is made from an oscillator to copy the shape of and a
+  /// frequency:
+  ///
+  /// ```c++
+  /// SharedLFO pwm(Triangle(), 5.0);
+  /// ```
+  ///
+  template <typename T>
+  SharedLFO(T shape, float f) {
+    shape.frequency = 0.0;
+    for (int i = 0; i < SHARED_LFO_TABLE_LEN; i++) {
+      shape.phase = (float)i / (float)SHARED_LFO_TABLE_LEN;
+      _table[i] = shape.step();
+    }
+    _table[SHARED_LFO_TABLE_LEN] = _table[0];
+    for (int i = 0; i < MODULATOR_BLOCK_LEN; i++) {
+      _phases[i] = 0.0;
+      _values[i] = _table[0];
+    }
+    _bank = NULL;
+    frequency = f;
+    phase = 0.0;
+    minValue = shape.minValue;
+    maxValue = shape.maxValue;
+  }
+  ///
+  /// ## Methods ##
+  ///
+  /// The `setRange` method scales the output to a new range.
+  ///
+  /// ```c++
+  /// SharedLFO pwm(Triangle(), 5.0);
+  /// pwm.setRange(0.05, 0.5);
+  /// ```
+  ///
+  void setRange(float vmin, float vmax) {
+    float scale = (maxValue != minValue) ? 
+      (vmax - vmin) / (maxValue - minValue) : 0.0;
+    for (int i = 0; i <= SHARED_LFO_TABLE_LEN; i++) {
+      _table[i] = vmin + ((_table[i] - minValue) * scale);
+    }
+    for (int i = 0; i < MODULATOR_BLOCK_LEN; i++) {
+      _values[i] = vmin + ((_values[i] - minValue) * scale);
+    }
+    minValue = vmin;
+    maxValue = vmax;
+  }
+  ///
+  /// The `render` method advances the LFO by the given number of samples,
+  /// and is called by the bank for each block.
+  ///
+  void render(int count) {
+    float phaseStep = STEP_TIME * frequency;
+    for (int i = 0; i < count; i++) {
+      _phases[i] = phase;
+      _values[i] = _lookup(phase);
+      phase += phaseStep;
+      if (phase >= 1.0) phase = fmod(phase, 1.0);
+    }
+  }
+  ///
+  /// The `valueAt` method returns the value at a sample of the current
+  /// block, optionally offset in phase. Offsets let each voice hear the LFO
+  /// at a different point in its cycle while it's only evaluated once.
+  ///
+  float valueAt(int i, float offset = 0.0) {
+    if (offset == 0.0) return(_values[i]);
+    float p = _phases[i] + offset;
+    p -= floorf(p);
+    return(_lookup(p));
+  }
+  ///
+  /// The `value` method returns the value at the sample voices are
+  /// currently being stepped for, optionally offset in phase.
+  ///
+  inline float value(float offset = 0.0);
+  friend class ModulatorBank;
+};
+///
+/// # ModulatorBank #
+///
+/// The `ModulatorBank` class is the base class for a patch's `Modulators`.
+///
+class ModulatorBank {
+protected:
+  // the modulators to evaluate
+  SharedLFO *_modulators[MODULATOR_BANK_LEN];
+  int _count;
+  // the number of phase offsets handed out
+  int _offsets;
+public:
+  /// ## Properties ##
+  ///
+  /// The `index` property is the sample of the current block that voices
+  /// are being stepped for. The plugin sets it before stepping each voice,
+  /// and voices with a `render` method can use `valueAt` instead.
+  int index;
+  ModulatorBank() {
+    _count = 0;
+    _offsets = 0;
+    index = 0;
+  }
+  /// ## Methods ##
+  ///
+  /// The `add` method adds a modulator to the bank so it's evaluated for
+  /// each block.
+  ///
+  void add(SharedLFO *lfo) {
+    if (_count >= MODULATOR_BANK_LEN) return;
+    lfo->_bank = this;
+    _modulators[_count++] = lfo;
+  }
+  ///
+  /// The `render` method evaluates all modulators for the given number of
+  /// samples. A patch can override it to change the modulators between 
+  /// blocks, and should then call this method.
+  ///
+  virtual void render(int count) {
+    if (count > MODULATOR_BLOCK_LEN) count = MODULATOR_BLOCK_LEN;
+    for (int i = 0; i < _count; i++) {
+      _modulators[i]->render(count);
+    }
+  }
+  ///
+  /// The `nextPhaseOffset` method returns a different phase offset each
+  /// time it's called, spread evenly around the cycle, which a voice can
+  /// take when it's constructed to keep its modulation from lining up with
+  /// other voices.
+  ///
+  float nextPhaseOffset() {
+    // step by the golden ratio so any number of offsets stay spread out
+    float offset = fmod((float)_offsets * 0.618034, 1.0);
+    _offsets++;
+    return(offset);
+  }
+  virtual ~ModulatorBank() { }
+  // test the modulator bank
+  static void test() {
+    SharedLFO lfo(Saw(), 1.0 / (4.0 * STEP_TIME));
+    lfo.setRange(0.0, 4.0);
+    ModulatorBank bank;
+    bank.add(&lfo);
+    bank.render(4);
+    assert(lfo.valueAt(0) == 0.0);
+    assert(lfo.valueAt(1) == 1.0);
+    assert(lfo.valueAt(3) == 3.0);
+    assert(lfo.valueAt(1, 0.5) == 3.0); // offset by half a cycle
+    bank.index = 2;
+    assert(lfo.value() == 2.0);
+    bank.render(1); // the phase carries on to the next block
+    assert(lfo.valueAt(0) == 0.0);
+    assert(bank.nextPhaseOffset() == 0.0);
+    assert(bank.nextPhaseOffset() > 0.6);
+  }
+};
+float SharedLFO::value(float offset) {
+  return(valueAt((_bank != NULL) ? _bank->index : 0, offset));
+}
+
+} // end namespace
+
+#endif
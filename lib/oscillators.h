@@ -105,7 +105,7 @@ public:
   /// ```
   ///
   virtual float step() {
-    phase += STEP_TIME * frequency;
+    phase += stepTime() * frequency;
     if (phase >= 1.0) {
       phase = fmod(phase, 1.0);
       if (syncSlave != NULL) syncSlave->phase = phase; 
@@ -148,6 +148,7 @@ public:
   }
   // signal
   virtual float step() {
+    CSYNTH_PROFILE_SCOPE(Sine);
     float value = sin(phase * TAU);
     if ((minValue != -1.0) || (maxValue != 1.0)) {
       value = minValue + (((value + 1.0) / 2.0) * (maxValue - minValue));
@@ -208,6 +209,7 @@ public:
     width = w;
   }
   virtual float step() {
+    CSYNTH_PROFILE_SCOPE(Pulse);
     float value = minValue;
     if (phase < width) value = maxValue;
     Oscillator::step();
@@ -253,6 +255,7 @@ public:
   Saw() : Oscillator() { }
   Saw(float f) : Oscillator(f) { }
   virtual float step() {
+    CSYNTH_PROFILE_SCOPE(Saw);
     float value = minValue + (phase * (maxValue - minValue));
     Oscillator::step();
     return(value);
@@ -293,6 +296,7 @@ public:
   Triangle() : Oscillator() { }
   Triangle(float f) : Oscillator(f) { }
   virtual float step() {
+    CSYNTH_PROFILE_SCOPE(Triangle);
     float p = 0.0;
     if (phase < 0.25) {
       p = 0.5 + (phase * 2.0); // 0.5 => 1.0
@@ -327,6 +331,167 @@ public:
   }
 };
 ///
+/// # Band-Limited Oscillators #
+///
+/// The sudden jumps and corners in the `Pulse`, `Saw`, and `Triangle`
+/// waves contain harmonics far above the Nyquist frequency, and at high
+/// notes those fold back down into the audible range as inharmonic
+/// aliasing. The `BandLimitedPulse`, `BandLimitedSaw`, and
+/// `BandLimitedTriangle` classes work the same way as the oscillators they
+/// derive from, but smooth each jump and corner over the samples either
+/// side of it using polynomial approximations of a band-limited step
+/// (PolyBLEP) and ramp (PolyBLAMP). This removes most of the aliasing for
+/// only a few extra operations per sample, and the output is identical to
+/// the original away from the jumps and corners.
+///
+/// ```c++
+/// BandLimitedSaw note(1760.0);
+/// float sample = note.step();
+/// ```
+///
+
+// the difference between a band-limited unit step and an abrupt one at the 
+//  given phase, where the step is at phase 0.0 and dt is the phase change 
+//  per sample
+static inline float polyBLEP(float t, float dt) {
+  if (t < dt) {
+    t /= dt;
+    return(t + t - (t * t) - 1.0f);
+  }
+  if (t > 1.0f - dt) {
+    t = (t - 1.0f) / dt;
+    return((t * t) + t + t + 1.0f);
+  }
+  return(0.0f);
+}
+// the difference between a band-limited corner and a sharp one, the 
+//  integral of the correction above
+static inline float polyBLAMP(float t, float dt) {
+  if (t < dt) {
+    t = (t / dt) - 1.0f;
+    return(-(t * t * t) / 3.0f);
+  }
+  if (t > 1.0f - dt) {
+    t = ((t - 1.0f) / dt) + 1.0f;
+    return((t * t * t) / 3.0f);
+  }
+  return(0.0f);
+}
+///
+/// # BandLimitedPulse #
+///
+class BandLimitedPulse : public Pulse {
+public:
+  BandLimitedPulse() : Pulse() { }
+  BandLimitedPulse(float f) : Pulse(f) { }
+  BandLimitedPulse(float f, float w) : Pulse(f, w) { }
+  virtual float step() {
+    CSYNTH_PROFILE_SCOPE(BandLimitedPulse);
+    float dt = stepTime() * frequency;
+    if (dt > 0.5f) dt = 0.5f;
+    // smooth the rising edge at phase 0 and the falling edge at the width
+    float t = phase - width;
+    if (t < 0.0f) t += 1.0f;
+    float value = ((phase < width) ? 1.0f : -1.0f) +
+                  polyBLEP(phase, dt) - polyBLEP(t, dt);
+    Oscillator::step();
+    return(minValue + ((value + 1.0f) * 0.5f * (maxValue - minValue)));
+  }
+  virtual float step(float f) {
+    frequency = f;
+    return(step());
+  }
+  // test the oscillator
+  static void test() {
+    BandLimitedPulse osc;
+    osc.setRange(-0.5, 0.5);
+    osc.frequency = 1.0 / (8.0 * STEP_TIME);
+    // edges land halfway, and other samples are the same as a pulse
+    assert(osc.step() == 0.0);
+    assert(osc.step() == 0.5);
+    assert(osc.step() == 0.5);
+    assert(osc.step() == 0.5);
+    assert(osc.step() == 0.0);
+    assert(osc.step() == -0.5);
+  }
+};
+///
+/// # BandLimitedSaw #
+///
+class BandLimitedSaw : public Saw {
+public:
+  BandLimitedSaw() : Saw() { }
+  BandLimitedSaw(float f) : Saw(f) { }
+  virtual float step() {
+    CSYNTH_PROFILE_SCOPE(BandLimitedSaw);
+    float dt = stepTime() * frequency;
+    if (dt > 0.5f) dt = 0.5f;
+    float value = (phase * 2.0f) - 1.0f - polyBLEP(phase, dt);
+    Oscillator::step();
+    return(minValue + ((value + 1.0f) * 0.5f * (maxValue - minValue)));
+  }
+  virtual float step(float f) {
+    frequency = f;
+    return(step());
+  }
+  // test the oscillator
+  static void test() {
+    BandLimitedSaw osc;
+    osc.setRange(0.0, 8.0);
+    osc.frequency = 1.0 / (8.0 * STEP_TIME);
+    assert(osc.step() == 4.0); // the jump lands halfway
+    assert(osc.step() == 1.0);
+    assert(osc.step() == 2.0);
+    for (int i = 0; i < 5; i++) osc.step();
+    assert(osc.step() == 4.0);
+  }
+};
+///
+/// # BandLimitedTriangle #
+///
+class BandLimitedTriangle : public Triangle {
+public:
+  BandLimitedTriangle() : Triangle() { }
+  BandLimitedTriangle(float f) : Triangle(f) { }
+  virtual float step() {
+    CSYNTH_PROFILE_SCOPE(BandLimitedTriangle);
+    float dt = stepTime() * frequency;
+    if (dt > 0.5f) dt = 0.5f;
+    float value;
+    if (phase < 0.25f) value = phase * 4.0f;
+    else if (phase < 0.75f) value = 2.0f - (phase * 4.0f);
+    else value = (phase * 4.0f) - 4.0f;
+    // round off the peak at phase 0.25 and the trough at 0.75, where the
+    //  slope changes by 8 per cycle
+    float peak = phase + 0.75f;
+    if (peak >= 1.0f) peak -= 1.0f;
+    float trough = phase + 0.25f;
+    if (trough >= 1.0f) trough -= 1.0f;
+    value += 4.0f * dt * (polyBLAMP(trough, dt) - polyBLAMP(peak, dt));
+    Oscillator::step();
+    return(minValue + ((value + 1.0f) * 0.5f * (maxValue - minValue)));
+  }
+  virtual float step(float f) {
+    frequency = f;
+    return(step());
+  }
+  // test the oscillator
+  static void test() {
+    BandLimitedTriangle osc;
+    osc.setRange(-2.0, 2.0);
+    osc.frequency = 1.0 / (8.0 * STEP_TIME);
+    // the peak and trough are rounded off, and other samples are the same
+    //  as a triangle
+    assert(osc.step() == 0.0);
+    assert(osc.step() == 1.0);
+    assert(fabs(osc.step() - (2.0 - (1.0 / 3.0))) < 0.00001);
+    assert(osc.step() == 1.0);
+    assert(osc.step() == 0.0);
+    assert(osc.step() == -1.0);
+    assert(fabs(osc.step() - (-2.0 + (1.0 / 3.0))) < 0.00001);
+  }
+};
+///
 /// # Interpolated #
 ///
 /*
@@ -420,7 +585,8 @@ public:
   }
   
   virtual float step() {
-    float phaseStep = STEP_TIME * frequency;
+    CSYNTH_PROFILE_SCOPE(Interpolated);
+    float phaseStep = stepTime() * frequency;
     IPoint *first = p;
     IPoint *last = p + (pcount - 1);
     // find a target to move towards, defaulting to the first point to easily 
@@ -527,12 +693,12 @@ protected:
     // resize the wave table if needed
     if (frequencyChanged) {
       _waveTableFrequency = frequency;
-      _waveTablePeriod = 1.0 / (frequency * STEP_TIME);
+      _waveTablePeriod = 1.0 / (frequency * sampleTime());
       int samples = (int)ceil(_waveTablePeriod);
       if (samples != _waveTableSamples) {
         _waveTableSamples = samples;
-        if (_waveTable != NULL) delete[] _waveTable;
-        _waveTable = new float[_waveTableSamples];
+        freeSamples(_waveTable);
+        _waveTable = allocateSamples(_waveTableSamples);
       }
     }
     // fill the wavetable if it's resized or changed amplitude
@@ -576,7 +742,8 @@ public:
   Additive(int partialCount, float f=0.0) : Oscillator(f) {
     if (partialCount < 1) partialCount = 1;
     _partialCount = partialCount;
-    partials = new AdditivePartial[_partialCount + 1];
+    partials = (AdditivePartial *)arenaAllocate(
+      sizeof(AdditivePartial) * (_partialCount + 1));
     // initialize partials
     for (int i = 1; i <= _partialCount; i++) {
       partials[i].phase = 0.0;
@@ -587,6 +754,7 @@ public:
     _waveTable = NULL;
   }
   virtual float step() {
+    CSYNTH_PROFILE_SCOPE(Additive);
     int i;
     if ((frequency == 0.0) || (_partialCount < 1)) return(0.0);
     // make sure the wave table is up-to-date
@@ -594,7 +762,7 @@ public:
     // interpolate the summed partials to get the current sample
     int sampleIndex;
     float sample, curr, next, mix;
-    float phaseStep = STEP_TIME * frequency;
+    float phaseStep = stepTime() * frequency;
     float value = 0.0;
     AdditivePartial *partial = &partials[1];
     for (i = 1; i <= _partialCount; i++) {
@@ -618,8 +786,8 @@ public:
     return(step());
   }
   ~Additive() {
-    if (partials != NULL) delete[] partials;
-    if (_waveTable != NULL) delete[] _waveTable;
+    arenaFree(partials);
+    freeSamples(_waveTable);
   }
   // compare the additive oscillator to an exact implementation
   static void test() {
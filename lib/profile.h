@@ -0,0 +1,186 @@
+#ifndef CSYNTH_PROFILE_H
+#define CSYNTH_PROFILE_H
+
+#ifdef CSYNTH_PROFILE
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#if defined(__i386__) || defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+#endif
+
+namespace CSynth {
+
+/// # Profiling #
+///
+/// When a patch is slow, it can be hard to tell which module is responsible.
+/// Compiling with `CSYNTH_PROFILE` defined makes the `step` method of every
+/// class in the library count its calls and the processor ticks spent in it,
+/// not including time spent in the generators it pulls samples from. When
+/// the flag is not defined, none of this code is compiled and there is no
+/// overhead at all. The plugin defines the flag when profiling is turned on
+/// in its GUI, and the report is shown in place of the compiler output.
+///
+/// Counts are aggregated by class, and also by instance name for any
+/// generator that has been given a name with its `setProfileName` method:
+///
+/// ```c++
+/// Sine lfo(4.0);
+/// lfo.setProfileName("lfo");
+/// ```
+///
+/// Because patches have one instance of a `Voice` for each voice of
+/// polyphony, instances sharing a name are counted together, so the report
+/// shows the total cost of that part of the patch across all voices.
+///
+#ifdef CSYNTH_PROFILE
+
+// the maximum number of counters to include in a report
+#define PROFILE_MAX_REPORT_COUNTERS 256
+
+class ProfileCounter {
+public:
+  const char *name;
+  // whether the counter is for a class or for named instances
+  bool isClass;
+  uint64_t calls;
+  uint64_t ticks;
+  ProfileCounter *next;
+  ProfileCounter(const char *n, bool c) {
+    name = n;
+    isClass = c;
+    calls = ticks = 0;
+    // add the counter to the list of all counters
+    next = first();
+    first() = this;
+  }
+  // the head of the list of all counters
+  static ProfileCounter *&first() {
+    static ProfileCounter *counter = NULL;
+    return(counter);
+  }
+  // get the counter with the given name, making one if needed; this
+  //  allocates and adds to the list without locking, so it relies on the 
+  //  plugin warming up every new patch and context on its worker thread, 
+  //  which registers the class counters and instance names before the 
+  //  audio thread steps anything
+  static ProfileCounter *named(const char *name, bool isClass) {
+    for (ProfileCounter *c = first(); c != NULL; c = c->next) {
+      if ((c->isClass == isClass) && (strcmp(c->name, name) == 0)) return(c);
+    }
+    return(new ProfileCounter(strdup(name), isClass));
+  }
+};
+
+// get a high-resolution timestamp, using the processor's cycle counter
+//  where it's available
+static inline uint64_t profileTicks() {
+#if defined(__i386__) || defined(__x86_64__)
+  return(__rdtsc());
+#else
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return(((uint64_t)t.tv_sec * 1000000000) + (uint64_t)t.tv_nsec);
+#endif
+}
+
+// a scope that charges the time from its construction to its destruction
+//  to a class and optionally an instance, minus the time of nested scopes
+class ProfileScope {
+protected:
+  ProfileCounter *classCounter;
+  ProfileCounter *instanceCounter;
+  ProfileScope *parent;
+  uint64_t start;
+  uint64_t childTicks;
+public:
+  ProfileScope(ProfileCounter *c, ProfileCounter *i) {
+    classCounter = c;
+    instanceCounter = i;
+    parent = current();
+    current() = this;
+    childTicks = 0;
+    start = profileTicks();
+  }
+  ~ProfileScope() {
+    uint64_t elapsed = profileTicks() - start;
+    uint64_t exclusive = (elapsed > childTicks) ? elapsed - childTicks : 0;
+    classCounter->calls++;
+    classCounter->ticks += exclusive;
+    if (instanceCounter != NULL) {
+      instanceCounter->calls++;
+      instanceCounter->ticks += exclusive;
+    }
+    if (parent != NULL) parent->childTicks += elapsed;
+    current() = parent;
+  }
+  // the innermost scope currently being timed on this thread, which is 
+  //  per thread because a context can be warmed up on the worker thread 
+  //  while the audio thread renders another from the same patch
+  static ProfileScope *&current() {
+    static thread_local ProfileScope *scope = NULL;
+    return(scope);
+  }
+};
+
+// format a report of all counters into the given buffer, with the most
+//  expensive first, returning the length of the report
+static inline int profileReport(char *buffer, int size) {
+  ProfileCounter *counters[PROFILE_MAX_REPORT_COUNTERS];
+  ProfileCounter *c;
+  int count = 0;
+  int i, j, n;
+  int length = 0;
+  uint64_t total = 0;
+  if (size < 1) return(0);
+  buffer[0] = '\0';
+  for (c = ProfileCounter::first(); c != NULL; c = c->next) {
+    if (c->calls == 0) continue;
+    if (c->isClass) total += c->ticks;
+    if (count < PROFILE_MAX_REPORT_COUNTERS) counters[count++] = c;
+  }
+  // sort by ticks, descending
+  for (i = 1; i < count; i++) {
+    c = counters[i];
+    for (j = i; (j > 0) && (counters[j - 1]->ticks < c->ticks); j--) {
+      counters[j] = counters[j - 1];
+    }
+    counters[j] = c;
+  }
+  n = snprintf(buffer, size, "%-24s %12s %12s %7s\n",
+               "module", "calls", "ticks/call", "share");
+  if ((n < 0) || (n >= size)) return(size - 1);
+  length += n;
+  for (i = 0; i < count; i++) {
+    c = counters[i];
+    char label[64];
+    if (c->isClass) snprintf(label, sizeof(label), "%s", c->name);
+    else snprintf(label, sizeof(label), "\"%s\"", c->name);
+    n = snprintf(buffer + length, size - length,
+      "%-24s %12llu %12.1f %6.1f%%\n", label, (unsigned long long)c->calls,
+      (double)c->ticks / (double)c->calls,
+      (total > 0) ? ((double)c->ticks * 100.0) / (double)total : 0.0);
+    if ((n < 0) || (n >= size - length)) return(size - 1);
+    length += n;
+  }
+  return(length);
+}
+
+// time the rest of the enclosing block, charging it to the given class
+//  and to the named instance if there is one
+#define CSYNTH_PROFILE_SCOPE(className) \
+  static ProfileCounter *_profileClassCounter = \
+    ProfileCounter::named(#className, true); \
+  ProfileScope _profileScope(_profileClassCounter, profileCounter)
+
+#else
+
+#define CSYNTH_PROFILE_SCOPE(className)
+
+#endif
+
+} // end namespace
+
+#endif
@@ -0,0 +1,362 @@
+#ifndef CSYNTH_RESAMPLING_H
+#define CSYNTH_RESAMPLING_H
+
+#include <assert.h>
+#include <math.h>
+#include <atomic>
+#include <thread>
+
+#include "signals.h"
+
+namespace CSynth {
+
+/// # Resampling #
+///
+/// Nonlinear processes like saturation create harmonics above the ones in
+/// their input, and any that land above the Nyquist frequency fold back
+/// down as inharmonic aliasing. Running such processes at twice the sample
+/// rate pushes that folding point up, and the classes below convert a
+/// signal to and from double rate so a module can do this internally.
+///
+/// Include the following code to use the classes below:
+///
+/// ```c++
+/// #include "resampling.h"
+/// using namespace CSynth;
+/// ```
+///
+/// Both use the same 15-tap half-band filter to remove images and content
+/// above the original Nyquist frequency. Half of its taps are zero, so each
+/// conversion only takes a handful of multiplies. Converting up and then
+/// back down delays the signal by 7 samples at the original rate.
+///
+/// ```c++
+/// HalfbandUpsampler up;
+/// HalfbandDownsampler down;
+/// float fast[2];
+/// up.process(in, fast);
+/// fast[0] = saturate(fast[0]);
+/// fast[1] = saturate(fast[1]);
+/// float out = down.process(fast);
+/// ```
+///
+
+// the nonzero taps of the half-band filter either side of the center tap,
+//  which is 0.5 (a windowed sinc, with the taps summing to 1)
+#define HALFBAND_C1 0.29854114f
+#define HALFBAND_C3 -0.05882477f
+#define HALFBAND_C5 0.01094841f
+#define HALFBAND_C7 -0.00066478f
+// the most samples converted in one pass of a block
+#define RESAMPLING_BLOCK_LEN 64
+
+///
+/// # HalfbandUpsampler #
+///
+/// The `HalfbandUpsampler` class turns each input sample into two output
+/// samples at double the rate.
+///
+class HalfbandUpsampler {
+protected:
+  // the most recent input samples, newest first
+  float _history[8];
+public:
+  HalfbandUpsampler() {
+    for (int i = 0; i < 8; i++) _history[i] = 0.0;
+  }
+  /// The `process` method takes one input sample and writes two output
+  /// samples to the given array.
+  void process(float in, float *out) {
+    for (int i = 7; i > 0; i--) _history[i] = _history[i - 1];
+    _history[0] = in;
+    float *h = _history;
+    // interpolate the sample halfway between the center pair
+    out[0] = 2.0f * ((HALFBAND_C1 * (h[3] + h[4])) +
+                     (HALFBAND_C3 * (h[2] + h[5])) +
+                     (HALFBAND_C5 * (h[1] + h[6])) +
+                     (HALFBAND_C7 * (h[0] + h[7])));
+    // the center tap passes an input sample through unchanged
+    out[1] = h[3];
+  }
+  // test the upsampler
+  static void test() {
+    HalfbandUpsampler up;
+    float out[2];
+    // a constant signal stays constant once the filter fills
+    for (int i = 0; i < 8; i++) up.process(1.0, out);
+    assert(fabs(out[0] - 1.0) < 0.00001);
+    assert(out[1] == 1.0);
+  }
+};
+///
+/// # HalfbandDownsampler #
+///
+/// The `HalfbandDownsampler` class turns each pair of samples at double
+/// the rate into one output sample.
+///
+class HalfbandDownsampler {
+protected:
+  // the most recent even and odd input samples, newest first
+  float _even[8];
+  float _odd[5];
+public:
+  HalfbandDownsampler() {
+    for (int i = 0; i < 8; i++) _even[i] = 0.0;
+    for (int i = 0; i < 5; i++) _odd[i] = 0.0;
+  }
+  /// The `process` method takes two input samples from an array and
+  /// returns one output sample.
+  float process(const float *in) {
+    for (int i = 7; i > 0; i--) _even[i] = _even[i - 1];
+    for (int i = 4; i > 0; i--) _odd[i] = _odd[i - 1];
+    _even[0] = in[0];
+    _odd[0] = in[1];
+    float *e = _even;
+    return((HALFBAND_C7 * (e[0] + e[7])) +
+           (HALFBAND_C5 * (e[1] + e[6])) +
+           (HALFBAND_C3 * (e[2] + e[5])) +
+           (HALFBAND_C1 * (e[3] + e[4])) +
+           (0.5f * _odd[4]));
+  }
+  ///
+  /// It can also convert a block, taking `count` pairs of input samples and
+  /// writing `count` output samples. This gives the same output as
+  /// converting each pair in turn, but without shifting the history for
+  /// every sample.
+  ///
+  void process(const float *in, float *out, int count) {
+    // lay the history out in order ahead of the block so the taps can read 
+    //  straight through it
+    float even[RESAMPLING_BLOCK_LEN + 7];
+    float odd[RESAMPLING_BLOCK_LEN + 4];
+    while (count > 0) {
+      int n = (count < RESAMPLING_BLOCK_LEN) ? count : RESAMPLING_BLOCK_LEN;
+      for (int i = 0; i < 7; i++) even[i] = _even[6 - i];
+      for (int i = 0; i < 4; i++) odd[i] = _odd[3 - i];
+      for (int i = 0; i < n; i++) {
+        even[i + 7] = in[i * 2];
+        odd[i + 4] = in[(i * 2) + 1];
+      }
+      for (int i = 0; i < n; i++) {
+        const float *e = even + i;
+        out[i] = (HALFBAND_C7 * (e[7] + e[0])) +
+                 (HALFBAND_C5 * (e[6] + e[1])) +
+                 (HALFBAND_C3 * (e[5] + e[2])) +
+                 (HALFBAND_C1 * (e[4] + e[3])) +
+                 (0.5f * odd[i]);
+      }
+      // keep the newest samples for the next block
+      for (int i = 0; i < 8; i++) _even[i] = even[n + 6 - i];
+      for (int i = 0; i < 5; i++) _odd[i] = odd[n + 3 - i];
+      in += n * 2;
+      out += n;
+      count -= n;
+    }
+  }
+  // test the downsampler
+  static void test() {
+    HalfbandUpsampler up;
+    HalfbandDownsampler down;
+    float fast[2];
+    // a constant signal passes through at the same level
+    float out = 0.0;
+    for (int i = 0; i < 16; i++) {
+      up.process(1.0, fast);
+      out = down.process(fast);
+    }
+    assert(fabs(out - 1.0) < 0.00001);
+    // an impulse comes out 7 samples later
+    HalfbandUpsampler up2;
+    HalfbandDownsampler down2;
+    float peak = 0.0;
+    int peakIndex = -1;
+    for (int i = 0; i < 16; i++) {
+      up2.process((i == 0) ? 1.0 : 0.0, fast);
+      out = down2.process(fast);
+      if (out > peak) {
+        peak = out;
+        peakIndex = i;
+      }
+    }
+    assert(peakIndex == 7);
+    // converting a block matches converting each pair
+    HalfbandDownsampler single, block;
+    float in[200], a[100], b[100];
+    for (int i = 0; i < 200; i++) in[i] = sinf((float)(i * i) * 0.01f);
+    for (int i = 0; i < 100; i++) a[i] = single.process(in + (i * 2));
+    block.process(in, b, 30);
+    block.process(in + 60, b + 30, 70);
+    for (int i = 0; i < 100; i++) assert(fabs(a[i] - b[i]) < 0.000001);
+  }
+};
+///
+/// # Oversampled #
+///
+/// The `Oversampler` class is a processor that steps its source several
+/// times for each output sample, with every generator feeding into it
+/// running as if the sample rate were that many times higher. The result is
+/// filtered and converted back down to the original rate. This lets a part
+/// of a voice that aliases badly, like a fast `FM` pair or a `Pulse` with
+/// quick width changes, pay for oversampling on its own without running the
+/// whole synth faster.
+///
+/// The `factor` property sets how many times faster the source runs, and
+/// can be 1, 2, or 4. Frequencies and times keep their meaning at any
+/// factor, but the output is delayed by 3.5 samples at 2 times and 5.25
+/// samples at 4 times. Sources that work out a length in samples when
+/// they're set up, like `Delay`, should not be oversampled. The higher rate
+/// applies only on the thread stepping the oversampler, so a patch can be 
+/// stepped from two threads at once.
+///
+/// ```c++
+/// Sine modulator(220.0);
+/// FM fm(&modulator);
+/// Oversampler fast(&fm);
+/// fast.factor = 4;
+/// float sample = fast.step();
+/// ```
+///
+/// The `Oversampled` class template does the same for a module it contains,
+/// which is its `module` property, and takes the same constructor arguments:
+///
+/// ```c++
+/// Oversampled<Pulse> pulse(110.0);
+/// pulse.factor = 2;
+/// pulse.module.width = 0.1;
+/// float sample = pulse.step();
+/// ```
+///
+class Oversampler : public Processor {
+protected:
+  // converters for each halving of the rate
+  HalfbandDownsampler _down[2];
+  // step the source at the higher rate for the duration of a scope
+  class Scope {
+  protected:
+    double _previous;
+  public:
+    Scope(int factor) {
+      __atomic_add_fetch(&_oversampling, 1, __ATOMIC_RELAXED);
+      _previous = stepScale();
+      stepScale() = _previous / (double)factor;
+    }
+    ~Scope() {
+      stepScale() = _previous;
+      __atomic_sub_fetch(&_oversampling, 1, __ATOMIC_RELAXED);
+    }
+  };
+  // convert samples at the higher rate down to the output rate in place
+  void _decimate(float *fast, float *out, int count) {
+    if (factor >= 4) {
+      _down[1].process(fast, fast, count * 2);
+    }
+    _down[0].process(fast, out, count);
+  }
+public:
+  /// ## Properties ##
+  ///
+  /// The `factor` property is the number of times the source is stepped
+  /// for each output sample.
+  int factor;
+  Oversampler() : Processor() {
+    factor = 2;
+  }
+  Oversampler(Generator *s) : Oversampler() {
+    source = s;
+  }
+  virtual float step() {
+    CSYNTH_PROFILE_SCOPE(Oversampler);
+    if (factor < 2) return(Processor::step());
+    if (source == NULL) return(0.0);
+    int n = (factor >= 4) ? 4 : 2;
+    Scope scope(n);
+    // when advancing, the source only needs to cover the same time
+    if (_steps > 1) return(source->advance(_steps * n));
+    float fast[4];
+    for (int i = 0; i < n; i++) fast[i] = source->step();
+    float out;
+    _decimate(fast, &out, 1);
+    return(out);
+  }
+  ///
+  /// The `render` method renders the source a block at a time at the higher
+  /// rate, so sources like filters that process blocks faster can do so.
+  ///
+  virtual void render(float *buffer, int count) {
+    CSYNTH_PROFILE_SCOPE(Oversampler);
+    if ((factor < 2) || (source == NULL)) {
+      Processor::render(buffer, count);
+      return;
+    }
+    int n = (factor >= 4) ? 4 : 2;
+    Scope scope(n);
+    float fast[RESAMPLING_BLOCK_LEN * 4];
+    while (count > 0) {
+      int block = (count < RESAMPLING_BLOCK_LEN) ? count : RESAMPLING_BLOCK_LEN;
+      source->render(fast, block * n);
+      _decimate(fast, buffer, block);
+      buffer += block;
+      count -= block;
+    }
+  }
+  // test the oversampler
+  static void test();
+};
+template <typename T>
+class Oversampled : public Oversampler {
+public:
+  T module;
+  template <typename... Args>
+  Oversampled(Args... args) : Oversampler(), module(args...) {
+    source = &module;
+  }
+};
+inline void Oversampler::test() {
+  // an oscillator runs at the same frequency at any factor
+  Saw saw(1.0 / (64.0 * STEP_TIME));
+  Oversampled<Saw> fast(1.0 / (64.0 * STEP_TIME));
+  for (int factor = 2; factor <= 4; factor *= 2) {
+    fast.factor = factor;
+    fast.module.phase = saw.phase = 0.0;
+    float last = 0.0;
+    for (int i = 0; i < 32; i++) {
+      saw.step();
+      last = fast.step();
+    }
+    assert(fast.module.phase == saw.phase);
+    // the output lags the source, but follows its slope
+    assert((last > -0.2) && (last < 0.0));
+  }
+  // the time scale is restored afterward
+  assert(sampleTime() == STEP_TIME);
+  // oversampling on another thread doesn't change the rate on this one
+  {
+    Saw before(1.0 / (64.0 * STEP_TIME)), during(1.0 / (64.0 * STEP_TIME));
+    before.step();
+    std::atomic<int> stage(0);
+    std::thread other([&] {
+      Scope scope(4);
+      stage = 1;
+      while (stage.load() < 2) std::this_thread::yield();
+    });
+    while (stage.load() < 1) std::this_thread::yield();
+    assert(sampleTime() == STEP_TIME);
+    during.step();
+    assert(during.phase == before.phase);
+    stage = 2;
+    other.join();
+  }
+  // rendering a block matches stepping each sample
+  Oversampled<Saw> a(1000.0), b(1000.0);
+  a.factor = b.factor = 4;
+  float stepped[100], rendered[100];
+  for (int i = 0; i < 100; i++) stepped[i] = a.step();
+  b.render(rendered, 100);
+  for (int i = 0; i < 100; i++) {
+    assert(fabs(stepped[i] - rendered[i]) < 0.000001);
+  }
+}
+
+} // end namespace
+
+#endif
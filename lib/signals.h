@@ -4,6 +4,7 @@
 #include "generators.h"
 
 #include <malloc.h>
+#include <stdint.h>
 #include <string.h>
 #include <math.h>
 #include <assert.h>
@@ -62,7 +63,7 @@ public:
   ///
   virtual float step() {
     if (source == NULL) return(0.0);
-    return(source->step());
+    return(pull(source));
   }
 };
 
@@ -119,6 +120,7 @@ public:
     ratio = r;
   }
   virtual float step() {
+    CSYNTH_PROFILE_SCOPE(Amplifier);
     return(Processor::step() * ratio);
   }
   // test the amplifier
@@ -176,6 +178,7 @@ public:
     setRange(vmin, vmax);
   }
   virtual float step() {
+    CSYNTH_PROFILE_SCOPE(Limiter);
     static float s;
     s = Processor::step();
     if (s < minValue) s = minValue;
@@ -239,6 +242,7 @@ public:
     setRange(vmin, vmax);
   }
   virtual float step() {
+    CSYNTH_PROFILE_SCOPE(Rectifier);
     static float s, delta, range;
     static int flips;
     s = Processor::step();
@@ -341,15 +345,16 @@ public:
   /// ```
   ///
   virtual float step(float target = 0.0, float sourceRange = 2.0) {
+    CSYNTH_PROFILE_SCOPE(SlewRateLimiter);
     static float delta, maxDelta;
     if (source != NULL) {
-      target = source->step();
+      target = pull(source);
       sourceRange = source->maxValue - source->minValue;
     }
     if (target > value) {
       delta = target - value;
       if (riseTime > 0.0) {
-        maxDelta = sourceRange / (riseTime / STEP_TIME);
+        maxDelta = sourceRange / (riseTime / stepTime());
         if (delta > maxDelta) delta = maxDelta;
       }
       value += delta;
@@ -357,7 +362,7 @@ public:
     else if (target < value) {
       delta = value - target;
       if (fallTime > 0.0) {
-        maxDelta = sourceRange / (fallTime / STEP_TIME);
+        maxDelta = sourceRange / (fallTime / stepTime());
         if (delta > maxDelta) delta = maxDelta;
       }
       value -= delta;
@@ -435,6 +440,7 @@ public:
     steps = st;
   }
   virtual float step() {
+    CSYNTH_PROFILE_SCOPE(Quantizer);
     static float s, interval;
     s = Processor::step();
     if (steps > 0) {
@@ -517,13 +523,14 @@ public:
     sampled = 0.0;
   }
   virtual float step() {
+    CSYNTH_PROFILE_SCOPE(SampleAndHold);
     static float s;
     s = Processor::step();
     if (phase >= 1.0) {
       phase = fmod(phase, 1.0);
       sampled = s;
     }
-    phase += STEP_TIME * frequency;
+    phase += stepTime() * frequency;
     return(sampled);
   }
   // test the sample and hold processor
@@ -552,33 +559,155 @@ public:
 ///
 /// Each instance of the `Splitter` class distributes its signal to multiple 
 /// outputs, represented by instances of the `SplitterOutput` class. Whenever
-/// the `step` method of one of these outputs is called, it in turn gets a 
-/// sample from the splitter's source in such a way that all outputs will stay 
-/// synchronized whether their `step` methods are called for every sample 
-/// or not.
+/// the `step` or `render` method of one of these outputs is called, it in
+/// turn gets samples from the splitter's source in such a way that all
+/// outputs will stay synchronized whether they're called for every sample 
+/// or not. The output that gets furthest ahead renders new samples from the 
+/// source into a buffer, and the others read them from the buffer, so the 
+/// source runs once no matter how many outputs there are.
+///
+/// An output that's read late gets the newest samples, as if it had been 
+/// read all along: reading `count` samples never starts more than `count` 
+/// samples behind the newest one, and any samples passed over are counted 
+/// as skipped. This means outputs read one sample at a time in any order 
+/// hear the current value, and outputs that render blocks of the same size
+/// hear the same samples. An output can instead be set to read the samples
+/// it missed with its `backlog` property.
 class Splitter;
 class SplitterOutput : public Processor {
 protected:
-  // whether this output has sent the current output value
-  int sent;
+  // the number of samples this output has read
+  int64_t _position;
 public:
   // override the source property to force it to be splitter
   Splitter *source;
+  ///
+  /// The `skipped` property of an output counts the samples it has missed
+  /// by falling behind the other outputs.
+  int64_t skipped;
+  ///
+  /// The `backlog` property, when true, makes an output that's read late 
+  /// hear every sample it missed instead of skipping to the newest ones, 
+  /// which lets outputs render blocks of different sizes. It's delayed by 
+  /// as much as it fell behind, up to the last `SPLITTER_BUFFER_LEN` 
+  /// samples, and an output that falls further behind than that skips 
+  /// ahead to the oldest sample still buffered. It's false by default.
+  ///
+  /// ```c++
+  /// Splitter split(&osc);
+  /// split.output[1].backlog = true;
+  /// float block[64];
+  /// split.output[0].render(block, 64);
+  /// float sample = split.output[1].step(); // the same as block[0]
+  /// ```
+  ///
+  bool backlog;
   SplitterOutput() : Processor() {
     source = NULL;
-    sent = 0;
+    _position = 0;
+    skipped = 0;
+    backlog = false;
   }
+  ///
+  /// Besides the outputs a splitter is made with, any number of outputs 
+  /// can be connected to it by passing it to the constructor of 
+  /// `SplitterOutput`. A new output starts at the oldest buffered sample.
+  ///
+  /// ```c++
+  /// Splitter split(&osc);
+  /// SplitterOutput extra(&split);
+  /// ```
+  ///
+  inline SplitterOutput(Splitter *s);
+  ///
+  /// The `catchUp` method skips an output ahead so the next sample it reads
+  /// is the newest one the splitter has, counting any it passes over as 
+  /// skipped, which is useful for an output that reads its backlog. An 
+  /// output that's already caught up is left where it is.
+  ///
+  /// ```c++
+  /// Splitter split(&osc);
+  /// split.output[1].backlog = true;
+  /// split.output[0].step();
+  /// split.output[0].step();
+  /// split.output[1].catchUp();
+  /// float sample = split.output[1].step(); // the same as the last one
+  /// ```
+  ///
+  inline void catchUp();
   virtual float step();
+  virtual void render(float *buffer, int count);
   friend class Splitter;
 };
+// the number of samples a splitter buffers for its outputs
+#define SPLITTER_BUFFER_LEN 64
 class Splitter : public Processor {
 protected:
-  float value;
+  // the most recent samples from the source, kept in a ring where the 
+  //  sample at a position is stored at that position modulo the length
+  float _buffer[SPLITTER_BUFFER_LEN];
+  // the positions of the oldest sample in the buffer and the one after the 
+  //  newest
+  int64_t _start, _end;
   int outputCount;
+  // get more samples from the source for an output that's caught up with
+  //  all the others, writing over the oldest samples in the buffer
+  void _fill(SplitterOutput *out, int count) {
+    int n = (count < SPLITTER_BUFFER_LEN) ? count : SPLITTER_BUFFER_LEN;
+    int offset = (int)(_end % SPLITTER_BUFFER_LEN);
+    if (source == NULL) {
+      for (int i = 0; i < n; i++) {
+        _buffer[(offset + i) % SPLITTER_BUFFER_LEN] = 0.0;
+      }
+    }
+    // cover as many samples as the output being advanced
+    else if ((n == 1) && (out->_steps > 1)) {
+      _buffer[offset] = source->advance(out->_steps);
+    }
+    else if (n == 1) _buffer[offset] = source->step();
+    else {
+      // render in two parts if the samples wrap around the end of the ring
+      int first = SPLITTER_BUFFER_LEN - offset;
+      if (first > n) first = n;
+      source->render(_buffer + offset, first);
+      if (first < n) source->render(_buffer, n - first);
+    }
+    _end += n;
+    if (_end - _start > SPLITTER_BUFFER_LEN) {
+      _start = _end - SPLITTER_BUFFER_LEN;
+    }
+  }
+  // read samples for an output, getting more from the source if it's the 
+  //  furthest ahead
+  void _read(SplitterOutput *out, float *buffer, int count) {
+    // start a late output at the newest samples unless it reads its backlog
+    if ((! out->backlog) && (_end - out->_position > count)) {
+      out->skipped += (_end - count) - out->_position;
+      out->_position = _end - count;
+    }
+    while (count > 0) {
+      if (out->_position < _start) {
+        out->skipped += _start - out->_position;
+        out->_position = _start;
+      }
+      if (out->_position == _end) _fill(out, count);
+      // copy up to the newest sample or the end of the ring
+      int offset = (int)(out->_position % SPLITTER_BUFFER_LEN);
+      int available = (int)(_end - out->_position);
+      if (available > SPLITTER_BUFFER_LEN - offset) {
+        available = SPLITTER_BUFFER_LEN - offset;
+      }
+      int n = (count < available) ? count : available;
+      memcpy(buffer, _buffer + offset, n * sizeof(float));
+      out->_position += n;
+      buffer += n;
+      count -= n;
+    }
+  }
 public:
   /// ## Properties ##
   ///
-  /// The `output` property is an array of 16 `SplitterOutput` instances 
+  /// The `output` property is an array of `SplitterOutput` instances 
   /// that can be connected to further processing chains.
   SplitterOutput *output;
   ///
@@ -588,37 +717,30 @@ public:
   /// `Processor`, and optionally the number of outputs it should have, which
   /// will defaults to 2.
   Splitter(int count=2) : Processor() {
-    value = 0.0;
+    _start = _end = 0;
+    _buffer[0] = 0.0;
     // create outputs
     outputCount = count;
     output = new SplitterOutput[outputCount];
     // connect all outputs to the splitter
     for (int i = 0; i < outputCount; i++) {
       output[i].source = this;
-      // put all outputs in the sent state to get input on the first sample
-      output[i].sent = 1;
     }
   }
   Splitter(Generator *s, int count=2) : Splitter(count) {
     source = s;
   }
   virtual float step(SplitterOutput *out) {
-    // handle leading outputs
-    if (out->sent) {
-      value = Processor::step();
-      SplitterOutput *updateOutput = output;
-      for (int i = 0; i < outputCount; i++) {
-        updateOutput->sent = 0;
-        updateOutput++;
-      }
-      out->sent = 1;
-    }
-    // handle non-leading outputs
-    else {
-      out->sent = 1;
-    }
+    CSYNTH_PROFILE_SCOPE(Splitter);
+    float value;
+    _read(out, &value, 1);
     return(value);
   }
+  virtual void render(SplitterOutput *out, float *buffer, int count) {
+    CSYNTH_PROFILE_SCOPE(Splitter);
+    _read(out, buffer, count);
+  }
+  friend class SplitterOutput;
   // test the splitter
   static void test() {
     Pulse gen(1.0 / (2.0 * STEP_TIME));
@@ -628,11 +750,81 @@ public:
     assert(split.output[1].step() == -1.0); // fetch in a different order
     assert(split.output[0].step() == -1.0); // ...
     assert(split.output[2].step() == -1.0); // fetch late
+    assert(split.output[2].skipped == 1);
+    // outputs that render blocks of the same size hear the same samples, 
+    //  and a late one skips to the newest
+    Saw saw(1.0 / (4.0 * STEP_TIME));
+    saw.setRange(0.0, 4.0);
+    Splitter split2(&saw);
+    float a[6], b[6];
+    split2.output[0].render(a, 6);
+    split2.output[1].render(b, 6);
+    for (int i = 0; i < 6; i++) assert(b[i] == a[i]);
+    split2.output[0].render(a, 4);
+    assert(split2.output[1].step() == a[3]);
+    assert(split2.output[1].skipped == 3);
+    // outputs that read their backlog can read blocks of any size
+    SplitterOutput extra(&split2);
+    split2.output[1].backlog = extra.backlog = true;
+    extra.catchUp();
+    assert(extra.step() == a[3]);
+    int64_t extraSkipped = extra.skipped;
+    int64_t skipped = split2.output[1].skipped;
+    split2.output[0].render(a, 6);
+    for (int i = 0; i < 6; i++) b[i] = split2.output[1].step();
+    extra.render(b, 3);
+    extra.render(b + 3, 3);
+    for (int i = 0; i < 6; i++) {
+      assert(a[i] == (float)((i + 10) % 4));
+      assert(b[i] == a[i]);
+    }
+    assert(extra.skipped == extraSkipped);
+    // an output that lags by less than a buffer reads every sample, even 
+    //  when the leader has stepped one sample at a time
+    float lead[SPLITTER_BUFFER_LEN - 1];
+    for (int i = 0; i < SPLITTER_BUFFER_LEN - 1; i++) {
+      lead[i] = split2.output[0].step();
+    }
+    for (int i = 0; i < SPLITTER_BUFFER_LEN - 1; i++) {
+      assert(split2.output[1].step() == lead[i]);
+    }
+    assert(split2.output[1].skipped == skipped);
+    // an output that falls a whole buffer behind skips ahead
+    float c[SPLITTER_BUFFER_LEN];
+    split2.output[0].render(c, SPLITTER_BUFFER_LEN);
+    assert(split2.output[1].step() == c[0]);
+    assert(split2.output[1].skipped == skipped);
+    split2.output[0].render(c, SPLITTER_BUFFER_LEN);
+    assert(split2.output[1].step() == c[0]);
+    assert(split2.output[1].skipped == skipped + SPLITTER_BUFFER_LEN - 1);
+    // an output can catch up to the newest sample instead, skipping any 
+    //  older ones it hasn't read
+    float last = 0.0;
+    split2.output[1].catchUp();
+    skipped = split2.output[1].skipped;
+    for (int i = 0; i < 3; i++) last = split2.output[0].step();
+    split2.output[1].catchUp();
+    assert(split2.output[1].step() == last);
+    assert(split2.output[1].skipped == skipped + 3);
+    split2.output[1].catchUp();
+    assert(split2.output[1].skipped == skipped + 3);
   }
 };
+SplitterOutput::SplitterOutput(Splitter *s) : SplitterOutput() {
+  source = s;
+  _position = s->_start;
+}
+void SplitterOutput::catchUp() {
+  if (_position >= source->_end - 1) return;
+  skipped += (source->_end - 1) - _position;
+  _position = source->_end - 1;
+}
 float SplitterOutput::step() {
   return(source->step(this));
 }
+void SplitterOutput::render(float *buffer, int count) {
+  source->render(this, buffer, count);
+}
 
 ///
 /// # Mixer #
@@ -681,10 +873,11 @@ public:
     source2 = s2;
   }
   virtual float step() {
+    CSYNTH_PROFILE_SCOPE(Mixer);
     static float s;
     s = 0.0;
-    if (source != NULL) s += (source->step() * (1.0 - ratio));
-    if (source2 != NULL) s += (source2->step() * ratio);
+    if (source != NULL) s += (pull(source) * (1.0 - ratio));
+    if (source2 != NULL) s += (pull(source2) * ratio);
     return(s);
   }
   // test the mixer
@@ -702,6 +895,344 @@ public:
   }
 };
 
+///
+/// # WideMixer #
+///
+/// The `WideMixer` class mixes any number of signal generators, each with 
+/// its own gain. It does the work of a tree of `Mixer`s in one module, 
+/// summing four inputs at a time with vector arithmetic.
+///
+/// ```c++
+/// Sine a(220.0);
+/// Sine b(330.0);
+/// Sine c(440.0);
+/// WideMixer mix;
+/// mix.add(&a);
+/// mix.add(&b, 0.5);
+/// mix.add(&c, 0.25);
+/// float sample = mix.step();
+/// ```
+///
+
+typedef float MixerLanes __attribute__((vector_size(16)));
+
+/// The `MixerLaw` enumeration lists ways a wide mixer can adjust the gains
+/// it's given:
+///
+///  - `MixerLinear` applies each gain as it is.
+///  - `MixerNormalized` scales the gains so they add up to 1.0, so inputs
+///    that all stay within -1.0 to 1.0 make a mix that does too.
+///  - `MixerEqualPower` scales the gains so their squares add up to 1.0,
+///    which keeps the loudness of unrelated signals steady as gains change.
+///
+typedef enum {
+  MixerLinear,
+  MixerNormalized,
+  MixerEqualPower
+} MixerLaw;
+
+class WideMixer : public Generator {
+protected:
+  // the inputs and the gains as they were set, with room for a whole 
+  //  number of lanes of four inputs, where unused inputs are silent
+  Generator **_inputs;
+  float *_gains;
+  int _count, _capacity;
+  // the gains being ramped toward and the change per sample while ramping,
+  //  in lanes of four inputs, so the gain applied is always the target 
+  //  minus the change times the number of samples left in the ramp
+  MixerLanes *_target;
+  MixerLanes *_delta;
+  int _remaining;
+  MixerLaw _law;
+  // a generator that emits silence, for inputs added as NULL and the 
+  //  unused slots that pad out the last lane
+  Generator _silence;
+  // make room for at least the given number of inputs
+  void _reserve(int count) {
+    if (count <= _capacity) return;
+    int capacity = (_capacity > 0) ? _capacity * 2 : 4;
+    while (capacity < count) capacity *= 2;
+    Generator **inputs = 
+      (Generator **)arenaAllocate(sizeof(Generator *) * capacity);
+    float *gains = (float *)arenaAllocate(sizeof(float) * capacity);
+    MixerLanes *target = 
+      (MixerLanes *)arenaAllocate(sizeof(MixerLanes) * (capacity / 4));
+    MixerLanes *delta = 
+      (MixerLanes *)arenaAllocate(sizeof(MixerLanes) * (capacity / 4));
+    for (int i = 0; i < capacity; i++) {
+      inputs[i] = (i < _count) ? _inputs[i] : &_silence;
+      gains[i] = (i < _count) ? _gains[i] : 0.0;
+    }
+    for (int l = 0; l < capacity / 4; l++) {
+      target[l] = (l < _capacity / 4) ? _target[l] : (MixerLanes){ 0.0 };
+      delta[l] = (l < _capacity / 4) ? _delta[l] : (MixerLanes){ 0.0 };
+    }
+    _free();
+    _inputs = inputs;
+    _gains = gains;
+    _target = target;
+    _delta = delta;
+    _capacity = capacity;
+  }
+  void _free() {
+    arenaFree(_inputs);
+    arenaFree(_gains);
+    arenaFree(_target);
+    arenaFree(_delta);
+  }
+  // copy the inputs and gains of another mixer, which has to be empty, 
+  //  pointing unused inputs at this mixer's own silence
+  void _copy(const WideMixer &other) {
+    _reserve(other._capacity);
+    for (int i = 0; i < other._count; i++) {
+      _inputs[i] = (other._inputs[i] == &other._silence) ? 
+        &_silence : other._inputs[i];
+      _gains[i] = other._gains[i];
+    }
+    for (int l = 0; l < other._capacity / 4; l++) {
+      _target[l] = other._target[l];
+      _delta[l] = other._delta[l];
+    }
+    _count = other._count;
+    _remaining = other._remaining;
+    _law = other._law;
+    smoothTime = other.smoothTime;
+  }
+  // work out the applied gains for the current law and start ramping to them
+  void _retarget(bool ramp) {
+    float scale = 1.0;
+    if (_law != MixerLinear) {
+      float sum = 0.0;
+      for (int i = 0; i < _count; i++) {
+        sum += (_law == MixerNormalized) ? 
+          fabsf(_gains[i]) : (_gains[i] * _gains[i]);
+      }
+      if (_law == MixerEqualPower) sum = sqrtf(sum);
+      if (sum > 0.0) scale = 1.0 / sum;
+    }
+    int samples = (int)(smoothTime / sampleTime());
+    if (! ramp) samples = 0;
+    float remaining = (float)_remaining;
+    for (int l = 0; l < _capacity / 4; l++) {
+      MixerLanes current = _target[l] - (_delta[l] * remaining);
+      for (int k = 0; k < 4; k++) {
+        int i = (l * 4) + k;
+        _target[l][k] = (i < _count) ? _gains[i] * scale : 0.0;
+      }
+      _delta[l] = (samples > 0) ? 
+        (_target[l] - current) / (float)samples : (MixerLanes){ 0.0 };
+    }
+    _remaining = (samples > 0) ? samples : 0;
+  }
+  // mix one sample with the gains of the current step of a ramp, only 
+  //  stepping the inputs in use in the last lane
+  inline float _ramped() {
+    MixerLanes sum = { 0.0, 0.0, 0.0, 0.0 };
+    MixerLanes x;
+    float remaining = (float)_remaining;
+    int full = _count / 4;
+    int l = 0;
+    for (; l < full; l++) {
+      Generator **inputs = _inputs + (l * 4);
+      for (int k = 0; k < 4; k++) x[k] = pull(inputs[k]);
+      sum += x * (_target[l] - (_delta[l] * remaining));
+    }
+    if (l * 4 < _count) {
+      Generator **inputs = _inputs + (l * 4);
+      x = (MixerLanes){ 0.0, 0.0, 0.0, 0.0 };
+      for (int k = 0; k < _count - (l * 4); k++) x[k] = pull(inputs[k]);
+      sum += x * (_target[l] - (_delta[l] * remaining));
+    }
+    _remaining -= (_remaining > 0);
+    return(sum[0] + sum[1] + sum[2] + sum[3]);
+  }
+  // mix one sample with steady gains
+  inline float _steady() {
+    MixerLanes sum = { 0.0, 0.0, 0.0, 0.0 };
+    MixerLanes x;
+    int full = _count / 4;
+    int l = 0;
+    for (; l < full; l++) {
+      Generator **inputs = _inputs + (l * 4);
+      for (int k = 0; k < 4; k++) x[k] = inputs[k]->step();
+      sum += x * _target[l];
+    }
+    if (l * 4 < _count) {
+      Generator **inputs = _inputs + (l * 4);
+      x = (MixerLanes){ 0.0, 0.0, 0.0, 0.0 };
+      for (int k = 0; k < _count - (l * 4); k++) x[k] = inputs[k]->step();
+      sum += x * _target[l];
+    }
+    return(sum[0] + sum[1] + sum[2] + sum[3]);
+  }
+public:
+  /// ## Properties ##
+  ///
+  /// The `smoothTime` property is the time in seconds a change of gain
+  /// takes to ramp in, which keeps gain changes from clicking. It defaults
+  /// to 0.005 seconds.
+  float smoothTime;
+  ///
+  /// ## Constructors ##
+  ///
+  /// A wide mixer starts out with no inputs, which produces silence.
+  ///
+  WideMixer() : Generator() {
+    _inputs = NULL;
+    _gains = NULL;
+    _target = _delta = NULL;
+    _count = _capacity = 0;
+    _remaining = 0;
+    _law = MixerLinear;
+    smoothTime = 0.005;
+  }
+  WideMixer(const WideMixer &other) : WideMixer() {
+    _copy(other);
+  }
+  WideMixer &operator=(const WideMixer &other) {
+    if (&other == this) return(*this);
+    Generator::operator=(other);
+    _free();
+    _inputs = NULL;
+    _gains = NULL;
+    _target = _delta = NULL;
+    _count = _capacity = 0;
+    _copy(other);
+    return(*this);
+  }
+  ~WideMixer() {
+    _free();
+  }
+  /// ## Methods ##
+  ///
+  /// The `add` method adds an input with the given gain, which defaults to
+  /// 1.0, and returns its index. Inputs are best added while setting up a 
+  /// voice, since adding one can allocate memory.
+  ///
+  int add(Generator *input, float gain = 1.0) {
+    _reserve(_count + 1);
+    _inputs[_count] = (input != NULL) ? input : &_silence;
+    _gains[_count] = gain;
+    _count++;
+    _retarget(false);
+    return(_count - 1);
+  }
+  ///
+  /// The `setGain` method changes the gain of the input with the given
+  /// index, ramping to it over `smoothTime`, and the `gain` method returns
+  /// the gain that was set.
+  ///
+  void setGain(int index, float gain) {
+    if ((index < 0) || (index >= _count)) return;
+    _gains[index] = gain;
+    _retarget(true);
+  }
+  float gain(int index) {
+    if ((index < 0) || (index >= _count)) return(0.0);
+    return(_gains[index]);
+  }
+  ///
+  /// The `setLaw` method changes the `MixerLaw` applied to the gains, 
+  /// ramping to the new gains over `smoothTime`, and the `law` method 
+  /// returns it. The law is `MixerLinear` by default.
+  ///
+  void setLaw(MixerLaw law) {
+    if (law == _law) return;
+    _law = law;
+    _retarget(true);
+  }
+  MixerLaw law() { return(_law); }
+  ///
+  /// The `count` method returns the number of inputs.
+  ///
+  int count() { return(_count); }
+  ///
+  /// Gains and ramps are worked out when they change, so `step` does the 
+  /// same arithmetic for every sample without checking for them. The 
+  /// `render` method fills a buffer by stepping the inputs in turn for 
+  /// each sample, and skips the ramp arithmetic for samples after any ramp 
+  /// ends. It doesn't render each input as a block, because most inputs 
+  /// are oscillators where each sample depends on the last, and stepping 
+  /// them in turn lets the processor overlap their work. The vector 
+  /// arithmetic sums four inputs at a time instead of four samples.
+  ///
+  virtual float step() {
+    CSYNTH_PROFILE_SCOPE(WideMixer);
+    return(_ramped());
+  }
+  virtual void render(float *buffer, int count) {
+    CSYNTH_PROFILE_SCOPE(WideMixer);
+    int i = 0;
+    if (_steps > 1) {
+      for (; i < count; i++) buffer[i] = _ramped();
+      return;
+    }
+    for (; (i < count) && (_remaining > 0); i++) buffer[i] = _ramped();
+    for (; i < count; i++) buffer[i] = _steady();
+  }
+  // test the wide mixer
+  static void test() {
+    DC a, b, c;
+    a.setRange(1.0, 1.0);
+    b.setRange(0.5, 0.5);
+    c.setRange(-0.25, -0.25);
+    WideMixer mix;
+    assert(mix.step() == 0.0);
+    mix.add(&a);
+    mix.add(&b);
+    assert(mix.step() == 1.5);
+    mix.smoothTime = 0.0;
+    mix.setLaw(MixerNormalized);
+    assert(mix.step() == 0.75);
+    mix.setLaw(MixerEqualPower);
+    assert(fabs(mix.step() - (1.5 * M_SQRT1_2)) < 0.00001);
+    mix.setLaw(MixerLinear);
+    // gain changes ramp in
+    mix.smoothTime = 4 * STEP_TIME;
+    mix.add(&c, 2.0);
+    assert(mix.step() == 1.0);
+    mix.setGain(0, 0.0);
+    assert(mix.step() == 1.0);
+    assert(mix.step() == 0.75);
+    assert(mix.step() == 0.5);
+    assert(mix.step() == 0.25);
+    assert(mix.step() == 0.0);
+    assert(mix.gain(0) == 0.0);
+    // rendering a block matches stepping
+    mix.setGain(0, 1.0);
+    WideMixer mix2;
+    mix2.smoothTime = mix.smoothTime;
+    mix2.add(&a, 0.0);
+    mix2.add(&b);
+    mix2.add(&c, 2.0);
+    mix2.setGain(0, 1.0);
+    float stepped[8], rendered[8];
+    for (int i = 0; i < 8; i++) stepped[i] = mix.step();
+    mix2.render(rendered, 3);
+    mix2.render(rendered + 3, 5);
+    for (int i = 0; i < 8; i++) assert(stepped[i] == rendered[i]);
+    // any number of inputs can be added
+    WideMixer many;
+    for (int i = 0; i < 37; i++) assert(many.add(&b, 0.25) == i);
+    assert(many.count() == 37);
+    assert(fabs(many.step() - (37 * 0.125)) < 0.0001);
+    many.setLaw(MixerNormalized);
+    for (int i = 0; i < 1000; i++) many.step();
+    assert(fabs(many.step() - 0.5) < 0.0001);
+    // copies have their own inputs and silence
+    WideMixer copy(mix2);
+    WideMixer assigned;
+    assigned = many;
+    mix2.setGain(1, 0.0);
+    many.add(&a);
+    assert(copy.count() == 3);
+    assert(assigned.count() == 37);
+    assert(copy.step() == 1.0);
+    assert(fabs(assigned.step() - 0.5) < 0.0001);
+  }
+};
+
 ///
 /// # Amplitude Modulation #
 ///
@@ -749,10 +1280,11 @@ public:
     modulator = s2;
   }
   virtual float step() {
+    CSYNTH_PROFILE_SCOPE(AM);
     static float amp;
     amp = 1.0;
-    if (modulator != NULL) amp += modulator->step();
-    if (source != NULL) return(amp * source->step());
+    if (modulator != NULL) amp += pull(modulator);
+    if (source != NULL) return(amp * pull(source));
     return(0.0);
   }
 };
@@ -798,13 +1330,15 @@ public:
     modulator = s2;
   }
   virtual float step() {
+    CSYNTH_PROFILE_SCOPE(FM);
     static float oldFreq, freq, s;
     if (source == NULL) return(0.0);
     // store the original frequency so we can keep 
     //  the center frequency to modulate around
     freq = oldFreq = source->frequency;
-    if (modulator != NULL) freq += modulator->step();
-    s = source->step(freq);
+    if (modulator != NULL) freq += pull(modulator);
+    source->frequency = freq;
+    s = pull(source);
     // restore the original frequency
     source->frequency = oldFreq;
     return(s);
@@ -6,6 +6,9 @@
 /// can be combined to produce more interesting sounds, rather than being a 
 /// complete toolkit for general sythensis or signal processing.
 ///
+/// Patches are built around a `Voice` class and an optional `Master` class,
+/// as described in the [patch host](host.h.md) documentation.
+///
 /// ## Modules ##
 ///
 ///  - A basic collection of [noise generators](generators.h.md)
@@ -27,9 +30,33 @@
 ///    other control values
 #include "envelopes.h"
 
-// TODO: fork / wide mixer
+///  - [Filters](filters.h.md) to shape the spectrum of a signal.
+#include "filters.h"
+
+///  - [Resampling](resampling.h.md) to run nonlinear processes at a higher
+///    sample rate.
+#include "resampling.h"
+
+///  - A [waveshaper](waveshaper.h.md) to distort a signal with any transfer
+///    function.
+#include "waveshaper.h"
+
+///  - [Control rate](control.h.md) processing to evaluate slowly-changing 
+///    signals less often than every sample.
+#include "control.h"
+
+///  - A [modulator bank](modulators.h.md) for LFOs shared by all voices.
+#include "modulators.h"
+
+///  - [Profiling](profile.h.md) hooks to find out which modules are 
+///    expensive.
+#include "profile.h"
+
+///  - [Arena allocation](arena.h.md) to keep the modules of each voice 
+///    together in memory.
+#include "arena.h"
+
 // TODO: crossfading delay line
 // TODO: linear/logarithmic CV functions
 // TODO: musical utils like interval ratios
-// TODO: filters
 
@@ -0,0 +1,91 @@
+// leave STEP_TIME undefined so the step time is taken at run time, as it is
+//  in patches built by the plugin
+#define CV_COUNT 1
+#include "synth.h"
+
+using namespace CSynth;
+
+// a voice that plays a square wave at the note's frequency
+class Voice {
+  public:
+  Pulse osc;
+  float step(float f, float v, float *cv) {
+    return(osc.step(f));
+  }
+};
+
+#include "host.h"
+
+// this program tests the parts of the synth library that depend on the
+//  step time being set at run time, which have to be built separately from
+//  the tests that fix it
+int main() {
+  assert(! IsComplete<Master>::value);
+
+  // the step time scope restores the previous step time
+  double initial = currentStepTime();
+  {
+    StepTimeScope outer(1.0 / 64.0);
+    assert(Generator::sampleTime() == 1.0 / 64.0);
+    {
+      StepTimeScope inner(1.0 / 32.0);
+      assert(Generator::sampleTime() == 1.0 / 32.0);
+    }
+    assert(Generator::sampleTime() == 1.0 / 64.0);
+  }
+  assert(currentStepTime() == initial);
+
+  // contexts made at different step times keep their own sample rate when
+  //  stepped alternately on one thread, so a 4 Hz square wave has a period
+  //  of 16 samples at 64 Hz and 8 samples at 32 Hz
+  void *slow = ext_create(1, 1.0 / 32.0);
+  void *fast = ext_create(1, 1.0 / 64.0);
+  assert(currentStepTime() == initial);
+  float cv[1] = { 0.0 };
+  float a[32], b[32];
+  for (int i = 0; i < 32; i++) {
+    a[i] = ext_step(fast, 0, 4.0, 1.0, cv);
+    b[i] = ext_step(slow, 0, 4.0, 1.0, cv);
+  }
+  for (int i = 0; i < 16; i++) {
+    assert(a[i] == a[i + 16]);
+    assert(a[i] == ((i < 8) ? 1.0 : -1.0));
+  }
+  for (int i = 0; i < 24; i++) {
+    assert(b[i] == b[i + 8]);
+    assert(b[i] == (((i % 8) < 4) ? 1.0 : -1.0));
+  }
+  assert(currentStepTime() == 1.0 / 32.0);
+  ext_destroy(fast);
+  ext_destroy(slow);
+
+  // growing a context adds voices without disturbing the ones it has, so 
+  //  a voice keeps its phase across the change
+  void *grown = ext_create(1, 1.0 / 64.0);
+  void *fixed = ext_create(1, 1.0 / 64.0);
+  for (int i = 0; i < 5; i++) {
+    ext_step(grown, 0, 4.0, 1.0, cv);
+    ext_step(fixed, 0, 4.0, 1.0, cv);
+  }
+  assert(ext_grow(grown, 1, 0) == NULL);
+  void *voices = ext_grow(grown, 3, 16);
+  assert(voices != NULL);
+  ext_attach(grown, voices);
+  for (int i = 0; i < 32; i++) {
+    a[i] = ext_step(grown, 0, 4.0, 1.0, cv);
+    b[i] = ext_step(fixed, 0, 4.0, 1.0, cv);
+    assert(a[i] == b[i]);
+  }
+  // the new voices were made together and warmed up the same way
+  a[0] = ext_step(grown, 1, 4.0, 1.0, cv);
+  b[0] = ext_step(grown, 2, 4.0, 1.0, cv);
+  assert(a[0] == b[0]);
+  // voices that aren't attached can be released instead
+  ext_release(ext_grow(fixed, 2, 0));
+  ext_destroy(grown);
+  ext_destroy(fixed);
+
+  // if we get here, no assertions failed
+  printf("All runtime step time tests passed!\n");
+  return(0);
+}
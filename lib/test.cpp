@@ -12,6 +12,9 @@ int main() {
   Pulse::test();
   Saw::test();
   Triangle::test();
+  BandLimitedPulse::test();
+  BandLimitedSaw::test();
+  BandLimitedTriangle::test();
   Interpolated::test();
   Additive::test();
 
@@ -31,6 +34,27 @@ int main() {
   Delay::test();
   Splitter::test();
   Mixer::test();
+  WideMixer::test();
+  
+  // test filters
+  Biquad::test();
+  SVF::test();
+  FilterCascade::test();
+  Biquad4::test();
+  Ladder::test();
+  HalfbandUpsampler::test();
+  HalfbandDownsampler::test();
+  Waveshaper::test();
+  Oversampler::test();
+  
+  // test control rate modulation
+  ControlRate::test();
+  ControlValue::test();
+  ControlClock::test();
+  ModulatorBank::test();
+  
+  // test memory management
+  Arena::test();
   
   // if we get here, no assertions failed
   printf("All tests passed!\n");
@@ -0,0 +1,199 @@
+#ifndef CSYNTH_WAVESHAPER_H
+#define CSYNTH_WAVESHAPER_H
+
+#include <assert.h>
+#include <math.h>
+#include <functional>
+
+#include "signals.h"
+#include "resampling.h"
+
+namespace CSynth {
+
+/// # Waveshaper #
+///
+/// The `Waveshaper` class is a processor that distorts its input by passing
+/// it through a transfer function, which maps each input value to an output
+/// value. The function is sampled into a table when it's set, so even a
+/// complicated curve costs only a lookup per sample.
+///
+/// Include the following code to use the classes below:
+///
+/// ```c++
+/// #include "waveshaper.h"
+/// using namespace CSynth;
+/// ```
+///
+/// Sharp corners in the curve, like those of a hard clipper, add harmonics
+/// above the Nyquist frequency that fold back as aliasing. Setting the
+/// `oversample` property to 2 or 4 runs just the shaping at a higher rate,
+/// using [half-band resamplers](resampling.h.md) around the lookup, which
+/// removes most of the aliasing without running the rest of the voice
+/// faster.
+///
+/// ```c++
+/// Sine osc(220.0);
+/// Waveshaper shaper(&osc);
+/// shaper.setCurve([] (float x) { return(tanhf(x * 3.0)); });
+/// shaper.oversample = 2;
+/// float sample = shaper.step();
+/// ```
+///
+
+// the number of segments in a waveshaper's table
+#define WAVESHAPER_TABLE_LEN 256
+
+// a generator that emits a chosen value, used to sample other processors
+class WaveshaperProbe : public Generator {
+public:
+  float value;
+  WaveshaperProbe() : Generator() { value = 0.0; }
+  virtual float step() { return(value); }
+};
+
+class Waveshaper : public Processor {
+protected:
+  // the transfer function sampled at even steps over the input range
+  float _table[WAVESHAPER_TABLE_LEN + 1];
+  // the lowest input in the table and the table steps per unit of input
+  float _inputMin, _scale;
+  // resamplers for each doubling of the rate
+  HalfbandUpsampler _up[2];
+  HalfbandDownsampler _down[2];
+  // look up a value in the table, clamping inputs outside its range
+  inline float _shape(float x) {
+    float p = (x - _inputMin) * _scale;
+    if (! (p > 0.0f)) return(_table[0]);
+    if (p >= (float)WAVESHAPER_TABLE_LEN) return(_table[WAVESHAPER_TABLE_LEN]);
+    int i = (int)p;
+    float mix = p - (float)i;
+    return(_table[i] + ((_table[i + 1] - _table[i]) * mix));
+  }
+  // shape two samples at double the rate, or four at four times the rate
+  inline float _shape2(float x) {
+    float fast[2];
+    _up[0].process(x, fast);
+    fast[0] = _shape(fast[0]);
+    fast[1] = _shape(fast[1]);
+    return(_down[0].process(fast));
+  }
+  inline float _shape4(float x) {
+    float mid[2], fast[4];
+    _up[0].process(x, mid);
+    _up[1].process(mid[0], fast);
+    _up[1].process(mid[1], fast + 2);
+    for (int i = 0; i < 4; i++) fast[i] = _shape(fast[i]);
+    mid[0] = _down[1].process(fast);
+    mid[1] = _down[1].process(fast + 2);
+    return(_down[0].process(mid));
+  }
+public:
+  /// ## Properties ##
+  ///
+  /// The `drive` property is a gain applied to the input before shaping,
+  /// which moves it further along the curve.
+  float drive;
+  ///
+  /// The `oversample` property sets the rate the shaping runs at as a
+  /// multiple of the sample rate, and can be 1, 2, or 4. Oversampling delays
+  /// the signal by 7 samples at 2 times and 10.5 samples at 4 times.
+  int oversample;
+  ///
+  /// ## Constructors ##
+  ///
+  /// The default curve passes the input through unchanged between -1.0 and
+  /// 1.0 and clips it outside that range.
+  ///
+  Waveshaper() : Processor() {
+    drive = 1.0;
+    oversample = 1;
+    setCurve([] (float x) { return(x); });
+  }
+  Waveshaper(Generator *s) : Waveshaper() {
+    source = s;
+  }
+  /// ## Methods ##
+  ///
+  /// The `setCurve` method samples a function into the table over the given
+  /// input range, which defaults to -1.0 to 1.0. Inputs outside the range
+  /// get the output at the nearest end of it.
+  ///
+  void setCurve(std::function<float(float)> curve, float inputMin = -1.0,
+                float inputMax = 1.0) {
+    _inputMin = inputMin;
+    _scale = (float)WAVESHAPER_TABLE_LEN / (inputMax - inputMin);
+    for (int i = 0; i <= WAVESHAPER_TABLE_LEN; i++) {
+      _table[i] = curve(inputMin + ((float)i / _scale));
+    }
+  }
+  ///
+  /// It can also sample the curve of a stateless processor like a `Limiter`
+  /// or `Rectifier`, using its current settings:
+  ///
+  /// ```c++
+  /// Limiter clip;
+  /// clip.setRange(-0.5, 0.5);
+  /// shaper.setCurve(&clip);
+  /// ```
+  ///
+  void setCurve(Processor *processor, float inputMin = -1.0,
+                float inputMax = 1.0) {
+    WaveshaperProbe probe;
+    Generator *source = processor->source;
+    processor->source = &probe;
+    setCurve([&] (float x) {
+      probe.value = x;
+      return(processor->step());
+    }, inputMin, inputMax);
+    processor->source = source;
+  }
+  ///
+  /// The `step` method shapes the next sample from the source.
+  ///
+  virtual float step() {
+    CSYNTH_PROFILE_SCOPE(Waveshaper);
+    float x = Processor::step() * drive;
+    if (oversample >= 4) return(_shape4(x));
+    if (oversample == 2) return(_shape2(x));
+    return(_shape(x));
+  }
+  // test the waveshaper
+  static void test() {
+    DC dc;
+    Waveshaper shaper(&dc);
+    // the default curve clips
+    dc.setRange(0.5, 0.5);
+    assert(shaper.step() == 0.5);
+    dc.setRange(2.0, 2.0);
+    assert(shaper.step() == 1.0);
+    // curves can come from functions
+    shaper.setCurve([] (float x) { return(x * x); }, 0.0, 2.0);
+    dc.setRange(0.5, 0.5);
+    assert(shaper.step() == 0.25);
+    // or from processors
+    Limiter limiter;
+    limiter.setRange(0.0, 0.5);
+    shaper.setCurve(&limiter);
+    assert(limiter.source == NULL);
+    assert(shaper.step() == 0.5);
+    dc.setRange(-0.5, -0.5);
+    assert(shaper.step() == 0.0);
+    Rectifier rectifier;
+    rectifier.setRange(0.0, 1.0);
+    shaper.setCurve(&rectifier);
+    assert(shaper.step() == 0.5);
+    // oversampling passes the curve through after a delay
+    shaper.setCurve([] (float x) { return(x); });
+    dc.setRange(0.25, 0.25);
+    for (int oversample = 2; oversample <= 4; oversample *= 2) {
+      Waveshaper fast(&dc);
+      fast.oversample = oversample;
+      for (int i = 0; i < 32; i++) fast.step();
+      assert(fabs(fast.step() - 0.25) < 0.0001);
+    }
+  }
+};
+
+} // end namespace
+
+#endif
@@ -3,18 +3,56 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
 #include <unistd.h>
 #include <dlfcn.h>
 #include <time.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
 
 #include "lv2/lv2plug.in/ns/ext/atom/atom.h"
 
 #include "csynth.h"
 
-typedef float (*StepFunc)(int, float, float, float*);
+typedef void *(*CreateFunc)(int, double);
+typedef void (*DestroyFunc)(void*);
+typedef void *(*GrowFunc)(void*, int, int);
+typedef void (*AttachFunc)(void*, void*);
+typedef void (*ReleaseFunc)(void*);
+typedef float (*StepFunc)(void*, int, float, float, float*);
+typedef void (*RenderFunc)(void*, int, float, float, float*, float*, int);
+typedef void (*MasterFunc)(void*, float*, int, float*);
+typedef void (*ModulateFunc)(void*, int);
+typedef void (*NoteOnFunc)(void*, int, float, int);
+typedef void (*NoteOffFunc)(void*, int);
+typedef int (*ProfileReportFunc)(char*, int);
+// a function to poll during a build which returns whether the build 
+//  is no longer wanted
+typedef int (*BuildCancelledFunc)(void*);
 
 #define PATCH_PATH_BUFFER_LEN 1024
-#define PATCH_OUTPUT_BUFFER_LEN 1024
+#define PATCH_OUTPUT_BUFFER_LEN 16384
+// the milliseconds to wait for compiler output before checking whether 
+//  the build has been cancelled
+#define PATCH_BUILD_POLL_TIME 20
+// the number of samples to run each voice of a new patch for before use
+#define PATCH_WARM_UP_SAMPLES 64
+#define PATCH_DEPENDENCY_BUFFER_LEN 4096
+// the directory to keep built patches in so they can be reused, which has 
+//  the user ID appended
+#define PATCH_CACHE_DIR "/tmp/csynth-cache"
+
+// sample rates common enough to build patches for with the time between 
+//  samples fixed, so the compiler can fold it into constants
+static const int PATCH_FIXED_RATES[] = { 
+  44100, 48000, 88200, 96000, 176400, 192000, 0 
+};
 
 typedef struct {
   // the path to the user-supplied code for the patch
@@ -22,16 +60,61 @@ typedef struct {
   // paths to temporary files used to compile the patch
   char tmp_path[PATCH_PATH_BUFFER_LEN+1];
   char lib_path[PATCH_PATH_BUFFER_LEN+1];
-  // error output from the compiler, if any
+  char dep_path[PATCH_PATH_BUFFER_LEN+1];
+  // whether the library was copied from the cache instead of being built
+  int cached;
+  // error output from the compiler, if any, keeping the end if there's 
+  //  more than fits
   char output[PATCH_OUTPUT_BUFFER_LEN+1];
+  // the total number of bytes of output from the compiler
+  size_t output_length;
+  // the files the patch was compiled from, separated by newlines
+  char dependencies[PATCH_DEPENDENCY_BUFFER_LEN+1];
+  // the time in seconds between samples to run the patch at
+  double time_step;
   // whether the patch library was built successfully
   int built;
+  // whether the build was stopped because it was no longer wanted
+  int cancelled;
+  // the time the build took in seconds
+  double build_time;
   // whether the patch library has been loaded
   int loaded;
   // the loaded dynamic library the patch compiled to, if it compiled
   void *lib;
+  // the voices and master section of the patch for one plugin instance, 
+  //  and the number of voices it has
+  void *context;
+  int polyphony;
+  // the functions to call to make and destroy a context
+  CreateFunc create;
+  DestroyFunc destroy;
+  // the functions to call to make more voices for a context, add them to 
+  //  it, or destroy them if they won't be added
+  GrowFunc grow;
+  AttachFunc attach;
+  ReleaseFunc release;
+  // whether more voices are being made for the patch
+  int resizing;
+  // whether the patch is no longer in use and should be disposed of as 
+  //  soon as it's done resizing
+  int retired;
   // the function to call to generate the next sample
   StepFunc step;
+  // the function to call to generate a block of samples for a voice, 
+  //  given controller values for each sample
+  RenderFunc render;
+  // the function to call to evaluate modulators shared by all voices 
+  //  before rendering a block
+  ModulateFunc modulate;
+  // the functions to call when a voice starts or stops playing a note
+  NoteOnFunc note_on;
+  NoteOffFunc note_off;
+  // the function to call to process the mixed output of all voices
+  MasterFunc master;
+  // the function to call to format a profiling report, if the patch 
+  //  was built with profiling
+  ProfileReportFunc profile_report;
 } Patch;
 
 typedef struct {
@@ -39,79 +122,478 @@ typedef struct {
 	Patch* patch;
 } PatchAtom;
 
-// build a patch from the given C code
-static Patch *build_patch(const char *code_path, const char *bundle_path, double time_step) {
+// a message about voices being added to a patch's context to give it the 
+//  given number of voices
+typedef struct {
+	LV2_Atom atom;
+	Patch* patch;
+	void *voices;
+	int polyphony;
+} ContextAtom;
+
+// read the list of files a patch was compiled from out of the dependency 
+//  file written by the compiler, leaving out the generated wrapper
+static void read_patch_dependencies(Patch *patch) {
+  FILE *f = fopen(patch->dep_path, "r");
+  if (f == NULL) return;
+  char path[PATCH_PATH_BUFFER_LEN+1];
+  int path_len = 0;
+  int in_target = 1;
+  int length = 0;
+  int c, escaped = 0;
+  patch->dependencies[0] = '\0';
+  while (1) {
+    c = fgetc(f);
+    // backslashes escape spaces in paths and continue lines
+    if ((c == '\\') && (! escaped)) {
+      escaped = 1;
+      continue;
+    }
+    if ((c == EOF) || (((c == ' ') || (c == '\n') || (c == '\t')) && (! escaped))) {
+      // finish a path
+      if (path_len > 0) {
+        path[path_len] = '\0';
+        if (in_target) {
+          if (path[path_len - 1] == ':') in_target = 0;
+        }
+        else if (strcmp(path, patch->tmp_path) != 0) {
+          length += snprintf(patch->dependencies + length, 
+            PATCH_DEPENDENCY_BUFFER_LEN - length, 
+            "%s%s", (length > 0) ? "\n" : "", path);
+          if (length >= PATCH_DEPENDENCY_BUFFER_LEN) {
+            length = PATCH_DEPENDENCY_BUFFER_LEN;
+            break;
+          }
+        }
+        path_len = 0;
+      }
+      if (c == EOF) break;
+    }
+    else if ((c != '\n') && (path_len < PATCH_PATH_BUFFER_LEN)) {
+      path[path_len++] = c;
+    }
+    escaped = 0;
+  }
+  fclose(f);
+  remove(patch->dep_path);
+}
+
+// copy compiler output from a ring buffer holding the end of it into the 
+//  patch, noting how much was left out if it didn't all fit
+static void copy_patch_output(Patch *patch, const char *ring) {
+  size_t keep = patch->output_length;
+  int length = 0;
+  if (keep > PATCH_OUTPUT_BUFFER_LEN) {
+    // leave room for a note at the start
+    keep = PATCH_OUTPUT_BUFFER_LEN - 64;
+    length = snprintf(patch->output, 64, 
+      "[%lu bytes of earlier output omitted]\n", 
+      (unsigned long)(patch->output_length - keep));
+  }
+  size_t start = (patch->output_length - keep) % PATCH_OUTPUT_BUFFER_LEN;
+  for (size_t i = 0; i < keep; i++) {
+    patch->output[length++] = ring[(start + i) % PATCH_OUTPUT_BUFFER_LEN];
+  }
+  patch->output[length] = '\0';
+}
+
+// run a compiler command and capture all of its output, killing it early 
+//  if the build is cancelled
+static void run_compiler(Patch *patch, const char *command, 
+                         BuildCancelledFunc is_cancelled, void *cancel_data) {
+  char ring[PATCH_OUTPUT_BUFFER_LEN];
+  char chunk[1024];
+  int fds[2];
+  if (pipe(fds) != 0) {
+    warning("Failed to make a pipe for compiler output");
+    return;
+  }
+  pid_t pid = fork();
+  if (pid < 0) {
+    warning("Failed to start the compiler");
+    close(fds[0]);
+    close(fds[1]);
+    return;
+  }
+  if (pid == 0) {
+    // put the compiler in its own process group so it can be killed along 
+    //  with the processes it starts
+    setpgid(0, 0);
+    close(fds[0]);
+    dup2(fds[1], STDOUT_FILENO);
+    dup2(fds[1], STDERR_FILENO);
+    close(fds[1]);
+    execl("/bin/sh", "sh", "-c", command, (char *)NULL);
+    _exit(127);
+  }
+  // set the group from this side too, in case we need to kill it before 
+  //  the child gets a chance to
+  setpgid(pid, pid);
+  close(fds[1]);
+  struct pollfd pfd = { fds[0], POLLIN, 0 };
+  while (1) {
+    if ((is_cancelled != NULL) && (is_cancelled(cancel_data))) {
+      kill(-pid, SIGKILL);
+      patch->cancelled = 1;
+      break;
+    }
+    int ready = poll(&pfd, 1, PATCH_BUILD_POLL_TIME);
+    if (ready < 0) break;
+    if (ready == 0) continue;
+    ssize_t count = read(fds[0], chunk, sizeof(chunk));
+    if (count <= 0) break;
+    // keep the most recent output in the ring buffer
+    for (ssize_t i = 0; i < count; i++) {
+      ring[(patch->output_length + i) % PATCH_OUTPUT_BUFFER_LEN] = chunk[i];
+    }
+    patch->output_length += count;
+  }
+  close(fds[0]);
+  int status = 0;
+  waitpid(pid, &status, 0);
+  copy_patch_output(patch, ring);
+  // only check for the library once the compiler has finished writing it
+  if ((! patch->cancelled) && (WIFEXITED(status)) && 
+      (WEXITSTATUS(status) == 0) && (access(patch->lib_path, F_OK) == 0)) {
+    patch->built = 1;
+  }
+}
+
+// get the time between samples to fix in a patch build if the given time 
+//  is for one of the common sample rates, or zero if it isn't
+static double get_fixed_time_step(double time_step) {
+  for (int i = 0; PATCH_FIXED_RATES[i] > 0; i++) {
+    if (fabs((1.0 / time_step) - (double)PATCH_FIXED_RATES[i]) < 0.001) {
+      return(1.0 / (double)PATCH_FIXED_RATES[i]);
+    }
+  }
+  return(0.0);
+}
+
+// the starting value of a 64-bit FNV-1a hash
+#define PATCH_HASH_INIT 0xcbf29ce484222325ULL
+
+// add bytes to a hash
+static uint64_t hash_bytes(uint64_t hash, const void *data, size_t length) {
+  const unsigned char *p = (const unsigned char *)data;
+  for (size_t i = 0; i < length; i++) {
+    hash ^= p[i];
+    hash *= 0x100000001b3ULL;
+  }
+  return(hash);
+}
+
+// a function to call for each file a patch depends on, which returns zero 
+//  to stop
+typedef int (*DependencyFunc)(const char *, void *);
+
+// call a function for each of a newline-separated list of files, returning 
+//  whether it returned nonzero for all of them
+static int each_dependency(const char *dependencies, DependencyFunc func, 
+                           void *data) {
+  char path[PATCH_PATH_BUFFER_LEN+1];
+  const char *start = dependencies;
+  while (*start != '\0') {
+    const char *end = strchr(start, '\n');
+    size_t length = (end != NULL) ? (size_t)(end - start) : strlen(start);
+    if (length > PATCH_PATH_BUFFER_LEN) return(0);
+    memcpy(path, start, length);
+    path[length] = '\0';
+    if ((length > 0) && (! func(path, data))) return(0);
+    start += length;
+    if (*start == '\n') start++;
+  }
+  return(1);
+}
+
+// add the path and contents of a file to a hash
+static int hash_dependency(const char *path, void *data) {
+  uint64_t *hash = (uint64_t *)data;
+  FILE *f = fopen(path, "rb");
+  if (f == NULL) return(0);
+  *hash = hash_bytes(*hash, path, strlen(path) + 1);
+  char chunk[4096];
+  size_t count;
+  while ((count = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+    *hash = hash_bytes(*hash, chunk, count);
+  }
+  fclose(f);
+  return(1);
+}
+
+// return whether a file was last modified before the given time
+static int is_dependency_older(const char *path, void *data) {
+  const struct timespec *t = (const struct timespec *)data;
+  struct stat st;
+  if (stat(path, &st) != 0) return(0);
+  // only whole seconds are portable, so a file changed in the same second 
+  //  counts as newer
+  return(st.st_mtime < t->tv_sec);
+}
+
+// get the directory to cache built patches in, making it if needed, and 
+//  return whether it can be used, which it can't be if another user could 
+//  have put libraries in it
+static int get_patch_cache_dir(char *path, size_t size) {
+  snprintf(path, size, "%s-%d", PATCH_CACHE_DIR, (int)getuid());
+  mkdir(path, 0700);
+  struct stat st;
+  if (stat(path, &st) != 0) return(0);
+  return((S_ISDIR(st.st_mode)) && (st.st_uid == getuid()) && 
+         ((st.st_mode & 0077) == 0));
+}
+
+// copy a file by way of a temporary file so no reader sees part of it, 
+//  returning whether it was copied
+static int copy_file(const char *from, const char *to) {
+  char tmp_path[PATCH_PATH_BUFFER_LEN+16];
+  snprintf(tmp_path, sizeof(tmp_path), "%s.%x.tmp", to, rand());
+  FILE *in = fopen(from, "rb");
+  if (in == NULL) return(0);
+  FILE *out = fopen(tmp_path, "wb");
+  if (out == NULL) {
+    fclose(in);
+    return(0);
+  }
+  char chunk[4096];
+  size_t count;
+  int ok = 1;
+  while ((count = fread(chunk, 1, sizeof(chunk), in)) > 0) {
+    if (fwrite(chunk, 1, count, out) != count) ok = 0;
+  }
+  if (ferror(in)) ok = 0;
+  fclose(in);
+  if (fclose(out) != 0) ok = 0;
+  if ((ok) && (rename(tmp_path, to) == 0)) return(1);
+  remove(tmp_path);
+  return(0);
+}
+
+// get the path of the library cached for a build with the given key, 
+//  which is named for the contents of every file the build depended on so 
+//  that a library is never replaced while it may be loaded
+static void get_cached_lib_path(char *path, const char *dir, uint64_t key, 
+                                const char *dependencies, int *found) {
+  uint64_t hash = key;
+  *found = each_dependency(dependencies, hash_dependency, &hash);
+  snprintf(path, PATCH_PATH_BUFFER_LEN, "%s/csynth-patch-%016llx.so", 
+           dir, (unsigned long long)hash);
+}
+
+// use a library from the cache for a patch if one was built from the 
+//  same files as they are now, returning whether it was found; it's copied 
+//  because libraries loaded from the same file share their static state, 
+//  and each instance needs its own
+static int find_cached_patch(Patch *patch, const char *dir, uint64_t key,
+                             const char *manifest_path) {
+  char dependencies[PATCH_DEPENDENCY_BUFFER_LEN+1];
+  char lib_path[PATCH_PATH_BUFFER_LEN+1];
+  int found;
+  FILE *f = fopen(manifest_path, "rb");
+  if (f == NULL) return(0);
+  size_t length = fread(dependencies, 1, PATCH_DEPENDENCY_BUFFER_LEN, f);
+  fclose(f);
+  dependencies[length] = '\0';
+  get_cached_lib_path(lib_path, dir, key, dependencies, &found);
+  if ((! found) || (! copy_file(lib_path, patch->lib_path))) return(0);
+  memcpy(patch->dependencies, dependencies, sizeof(dependencies));
+  patch->cached = 1;
+  patch->built = 1;
+  return(1);
+}
+
+// copy a newly built library into the cache along with the list of files 
+//  it was built from, unless any of them changed after the build started
+static void cache_patch(Patch *patch, const char *dir, uint64_t key,
+                        const char *manifest_path, 
+                        const struct timespec *start) {
+  char lib_path[PATCH_PATH_BUFFER_LEN+1];
+  char tmp_path[PATCH_PATH_BUFFER_LEN+16];
+  int found;
+  // a list that didn't fit can't tell whether the library is current
+  if (strlen(patch->dependencies) >= PATCH_DEPENDENCY_BUFFER_LEN - 1) return;
+  if (! each_dependency(patch->dependencies, is_dependency_older, 
+                        (void *)start)) return;
+  get_cached_lib_path(lib_path, dir, key, patch->dependencies, &found);
+  if ((! found) || (! copy_file(patch->lib_path, lib_path))) return;
+  snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", patch->dep_path);
+  FILE *f = fopen(tmp_path, "wb");
+  if (f == NULL) return;
+  fputs(patch->dependencies, f);
+  fclose(f);
+  if (rename(tmp_path, manifest_path) != 0) remove(tmp_path);
+}
+
+// build a patch from the given C code, optionally with profiling counters,
+//  stopping early if the given function returns true during the build, or 
+//  reuse a library built from the same code if there is one
+static Patch *build_patch(const char *code_path, const char *bundle_path, 
+                          double time_step, int profile, 
+                          BuildCancelledFunc is_cancelled, void *cancel_data) {
+  struct timespec start, end, modified;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  // file times are on the realtime clock
+  clock_gettime(CLOCK_REALTIME, &modified);
   // allocate memory for the patch data
   Patch *patch = (Patch *)malloc(sizeof(Patch));
   if (patch == NULL) return(NULL);
   memset(patch, 0, sizeof(Patch));
   // store the path to the code the patch was compiled from
   snprintf(patch->code_path, PATCH_PATH_BUFFER_LEN, "%s", code_path);
+  // fix the time between samples at common sample rates so it can be 
+  //  folded into constants, otherwise passing it in when a context is made 
+  //  so that one library serves every other rate
+  double fixed_time_step = get_fixed_time_step(time_step);
+  patch->time_step = (fixed_time_step > 0.0) ? fixed_time_step : time_step;
+  // write the code that wraps the patch
+  char wrapper[PATCH_PATH_BUFFER_LEN + 256];
+  int length = snprintf(wrapper, sizeof(wrapper), 
+                        "#define CV_COUNT %d\n", CV_COUNT);
+  if (fixed_time_step > 0.0) {
+    length += snprintf(wrapper + length, sizeof(wrapper) - length, 
+                       "#define STEP_TIME (%.17g)\n", fixed_time_step);
+  }
+  length += snprintf(wrapper + length, sizeof(wrapper) - length, 
+                     "#include \"%s\"\n#include \"host.h\"\n", 
+                     patch->code_path);
+  // keep profiling counters from being shared as unique symbols so each 
+  //  patch counts separately and can be unloaded
+  char flags[PATCH_PATH_BUFFER_LEN + 128];
+  snprintf(flags, sizeof(flags), 
+    "-std=c++11 -I%s/lib -shared -Wall -Werror -fPIC %s", bundle_path, 
+    profile ? "-DCSYNTH_PROFILE -fno-gnu-unique" : "");
   // make random temporary paths
   int id = rand();
   int now = time(NULL);
   const char *dir = "/tmp";
   snprintf(patch->tmp_path, PATCH_PATH_BUFFER_LEN, "%s/csynth-patch-%x-%x.cpp", dir, now, id);
   snprintf(patch->lib_path, PATCH_PATH_BUFFER_LEN, "%s/csynth-patch-%x-%x.so", dir, now, id);
-  // write the code to a temp file
-  FILE *f = fopen(patch->tmp_path, "wb");
-  if (f == NULL) {
-    warning("Failed to open temporary code path for writing");
-    return(patch);
-  }
-  fprintf(f, "#define STEP_TIME %f\n", time_step);
-  fprintf(f, "#include \"%s\"\n", patch->code_path);
-  fprintf(f, "Voice voices[%i];\n"
-             "extern \"C\" float ext_step(int voice, float f, float v, float *cv) {\n"
-             "  return(voices[voice].step(f, v, cv));\n"
-             "}\n", MAX_VOICE_COUNT);
-  fclose(f);
-  // build the command
-  char command[1024];
-  sprintf(command, "g++ -std=c++11 -I%s/lib -shared -Wall -Werror -fPIC %s -lm -o %s 2>&1", 
-    bundle_path, patch->tmp_path, patch->lib_path);
-  // run the command
-  FILE *proc = popen(command, "r");
-  if (proc == NULL) {
-    warning("Failed to capture compiler output");
+  snprintf(patch->dep_path, PATCH_PATH_BUFFER_LEN, "%s/csynth-patch-%x-%x.d", dir, now, id);
+  // the code path is always a dependency, even if the build fails
+  snprintf(patch->dependencies, PATCH_DEPENDENCY_BUFFER_LEN, "%s", code_path);
+  // reuse a library built from the same wrapper, flags and files, except 
+  //  for profiled builds, whose counters would be shared by every instance 
+  //  that loaded them
+  char cache_dir[64];
+  char manifest_path[PATCH_PATH_BUFFER_LEN+1];
+  uint64_t key = 0;
+  int use_cache = (! profile) && 
+    (get_patch_cache_dir(cache_dir, sizeof(cache_dir)));
+  if (use_cache) {
+    key = hash_bytes(PATCH_HASH_INIT, wrapper, length);
+    key = hash_bytes(key, flags, strlen(flags));
+    snprintf(manifest_path, PATCH_PATH_BUFFER_LEN, 
+             "%s/csynth-patch-%016llx.deps", cache_dir, 
+             (unsigned long long)key);
+    use_cache = find_cached_patch(patch, cache_dir, key, manifest_path) ? 
+      -1 : 1;
   }
-  else {
-    fread(patch->output, 1, PATCH_OUTPUT_BUFFER_LEN, proc);
-    if (access(patch->lib_path, F_OK) == 0) {
-      patch->built = 1;
+  if (use_cache >= 0) {
+    // write the code to a temp file
+    FILE *f = fopen(patch->tmp_path, "wb");
+    if (f == NULL) {
+      warning("Failed to open temporary code path for writing");
+      return(patch);
+    }
+    fputs(wrapper, f);
+    fclose(f);
+    // build the command
+    char command[(PATCH_PATH_BUFFER_LEN * 4) + 256];
+    snprintf(command, sizeof(command), "g++ %s -MMD -MF %s %s -lm -o %s 2>&1", 
+      flags, patch->dep_path, patch->tmp_path, patch->lib_path);
+    // run the command
+    run_compiler(patch, command, is_cancelled, cancel_data);
+    read_patch_dependencies(patch);
+    if ((use_cache > 0) && (patch->built)) {
+      cache_patch(patch, cache_dir, key, manifest_path, &modified);
     }
-    pclose(proc);
   }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  patch->build_time = (double)(end.tv_sec - start.tv_sec) + 
+                      ((double)(end.tv_nsec - start.tv_nsec) * 1.0e-9);
   return(patch);
 }
 
-// load the patch's library
-static void load_patch(Patch *patch) {
+// run every voice of a patch context silently for a short time, so that 
+//  anything voices set up on first use and the code and data they touch 
+//  are ready before the patch is heard
+static void warm_up_context(Patch *patch, void *context, int polyphony) {
+  // the master section takes controller values for every sample
+  float cv[PATCH_WARM_UP_SAMPLES * CV_COUNT];
+  float buffer[PATCH_WARM_UP_SAMPLES];
+  memset(cv, 0, sizeof(cv));
+  if (patch->modulate != NULL) patch->modulate(context, 1);
+  for (int v = 0; v < polyphony; v++) {
+    for (int i = 0; i < PATCH_WARM_UP_SAMPLES; i++) {
+      patch->step(context, v, 440.0, 0.0, cv);
+    }
+  }
+  if (patch->master != NULL) {
+    memset(buffer, 0, sizeof(buffer));
+    patch->master(context, buffer, PATCH_WARM_UP_SAMPLES, cv);
+  }
+}
+
+// load the patch's library and make a context with the given number 
+//  of voices
+static void load_patch(Patch *patch, int polyphony) {
   if (patch->loaded) return;
   // try to load the shared library
   if (patch->lib == NULL) {
-    patch->lib = dlopen(patch->lib_path, RTLD_LAZY);
+    // resolve all symbols now so it doesn't happen in the audio thread
+    patch->lib = dlopen(patch->lib_path, RTLD_NOW);
   }
   if (patch->lib == NULL) {
     warning("Failed to open patch library");
   }
   else {
+    patch->create = dlsym(patch->lib, "ext_create");
+    patch->destroy = dlsym(patch->lib, "ext_destroy");
+    patch->grow = dlsym(patch->lib, "ext_grow");
+    patch->attach = dlsym(patch->lib, "ext_attach");
+    patch->release = dlsym(patch->lib, "ext_release");
     patch->step = dlsym(patch->lib, "ext_step");
-    if (patch->step == NULL) {
-      warning("Failed to find 'step' function in patch library");
+    // block rendering is optional, so this can be NULL
+    patch->render = dlsym(patch->lib, "ext_render");
+    // shared modulators are optional, so this can be NULL
+    patch->modulate = dlsym(patch->lib, "ext_modulate");
+    // note events are optional, so these can be NULL
+    patch->note_on = dlsym(patch->lib, "ext_note_on");
+    patch->note_off = dlsym(patch->lib, "ext_note_off");
+    // the master section is optional, so this can be NULL
+    patch->master = dlsym(patch->lib, "ext_master");
+    // profiling is optional, so this can be NULL
+    patch->profile_report = dlsym(patch->lib, "ext_profile_report");
+    if ((patch->create == NULL) || (patch->destroy == NULL) || 
+        (patch->grow == NULL) || (patch->attach == NULL) || 
+        (patch->release == NULL) || (patch->step == NULL)) {
+      warning("Failed to find required functions in patch library");
+      return;
     }
-    else {
-      patch->loaded = 1;
+    patch->context = patch->create(polyphony, patch->time_step);
+    if (patch->context == NULL) {
+      warning("Failed to make a context for the patch");
+      return;
     }
+    patch->polyphony = polyphony;
+    patch->loaded = 1;
   }
 }
 
+// run every voice of a loaded patch silently before it's used
+static void warm_up_patch(Patch *patch) {
+  if (! patch->loaded) return;
+  warm_up_context(patch, patch->context, patch->polyphony);
+}
+
 // release all resources associated with a patch
 static void dispose_patch(Patch *patch) {
   if (patch == NULL) return;
+  if (patch->context != NULL) patch->destroy(patch->context);
   if (patch->lib != NULL) dlclose(patch->lib);
   remove(patch->tmp_path);
   remove(patch->lib_path);
+  remove(patch->dep_path);
   free(patch);
 }
 
@@ -1,7 +1,7 @@
 #include "synth.h"
 using namespace CSynth;
 
-class Voice : protected Delay {
+class Voice {
   public:
   
   Sine *osc;
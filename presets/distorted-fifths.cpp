@@ -6,24 +6,39 @@ class Voice {
   
   Sine root;
   Sine fifth;
-  Limiter rootDist;
-  Limiter fifthDist;
+  Limiter clip;
+  Waveshaper rootDist;
+  Waveshaper fifthDist;
   Mixer mixer;
+  ControlClock control;
+  ControlValue drive;
+  float fifthRatio;
   
   Voice() {
     rootDist.source = &root;
     fifthDist.source = &fifth;
-    rootDist.minValue = fifthDist.minValue = 0.0;
+    // clip off the bottom and top of each wave, oversampling the clipper 
+    //  so the harmonics it adds don't fold back as aliasing
+    clip.setRange(0.0, 1.0);
+    rootDist.setCurve(&clip);
+    fifthDist.setCurve(&clip);
+    rootDist.oversample = fifthDist.oversample = 2;
     mixer.source = &rootDist;
     mixer.source2 = &fifthDist;
+    fifthRatio = powf(2.0, 5.0 / 12.0);
   }
 
   float step(float f, float v, float *cv) {
-    rootDist.maxValue = fifthDist.maxValue = 0.5 + (cv[1] * 0.5);
-    float amp = 1.0 / rootDist.maxValue;
+    // the mod wheel sets the distortion level, which only needs updating 
+    //  at control rate, but is ramped every sample to avoid zipper noise
+    if (control.tick()) {
+      float max = 0.5 + (cv[1] * 0.5);
+      drive.set(1.0 / max);
+    }
+    rootDist.drive = fifthDist.drive = drive.step();
     root.frequency = f;
-    fifth.frequency = f * powf(2.0, 5.0 / 12.0);
-    return(((mixer.step() * amp) - 0.5) * v);
+    fifth.frequency = f * fifthRatio;
+    return((mixer.step() - 0.5) * v);
   }
   
 };
@@ -0,0 +1,45 @@
+#include "synth.h"
+using namespace CSynth;
+
+class Voice {
+  public:
+  
+  Sine *osc;
+  
+  Voice() {
+    osc = new Sine();
+  }
+
+  float step(float f, float v, float *cv) {
+    return(v * osc->step(f) * 0.25);
+  }
+  
+};
+
+// feeds the mix of all voices into the master section one sample at a time
+class Input : public Generator {
+  public:
+  float value;
+  Input() : Generator() { value = 0.0; }
+  virtual float step() { return(value); }
+};
+
+// a single echo shared by all voices
+class Master {
+  public:
+  
+  Input input;
+  Delay echo;
+  
+  Master() {
+    echo.source = &input;
+    echo.setDelay(0.375);
+    echo.feedback = 0.35;
+  }
+  
+  float step(float in, float *cv) {
+    input.value = in;
+    return(in + (echo.step() * 0.3));
+  }
+  
+};
@@ -1,26 +1,38 @@
 #include "synth.h"
 using namespace CSynth;
 
-typedef struct {
-  Pulse pulse;
-  Triangle mod;
-  Sine tremolo;
-} Unit;
+// LFOs shared by all voices, which each voice hears at its own phase
+class Modulators : public ModulatorBank {
+  public:
+  
+  SharedLFO mod;
+  SharedLFO tremolo[2];
+  
+  Modulators() : mod(Triangle(), 5.0), 
+      tremolo{ SharedLFO(Sine(), 8.0), SharedLFO(Sine(), 9.5) } {
+    mod.setRange(0.05, 0.5);
+    add(&mod);
+    for (int i = 0; i < 2; i++) {
+      tremolo[i].setRange(0.0, 1.0);
+      add(&tremolo[i]);
+    }
+  }
+  
+};
 
 class Voice {
   public:
   
-  Unit units[2];
+  Modulators *modulators;
+  float offset;
+  BandLimitedPulse pulses[2];
   Mixer mixer;
   ADSR *envelope;
   
-  Voice() {
-    for (int i = 0; i < 2; i++) {
-      units[i].mod.frequency = 5.0;
-      units[i].mod.setRange(0.05, 0.5);
-      units[i].tremolo.frequency = 8.0 + ((float)i * 1.5);
-    }
-    mixer = Mixer(&(units[0].pulse), &(units[1].pulse));
+  Voice(Modulators *m) {
+    modulators = m;
+    offset = m->nextPhaseOffset();
+    mixer = Mixer(&pulses[0], &pulses[1]);
     mixer.ratio = 0.33;
     envelope = new ADSR(0.25, 0.0, 1.0, 0.5);
   }
@@ -32,14 +44,14 @@ class Voice {
     if (amp == 0.0) return(0.0);
     // get oscillator output
     float trem;
+    float depth = cv[1] * 0.1;
     for (int i = 0; i < 2; i++) {
-      units[i].pulse.frequency = f;
+      pulses[i].frequency = f;
       // modulate pulse width
-      units[i].pulse.width = units[i].mod.step();
+      pulses[i].width = modulators->mod.value(offset);
       // apply tremolo
-      units[i].tremolo.minValue = 1.0 - (cv[1] * 0.1);
-      trem = units[i].tremolo.step();
-      units[i].pulse.setRange(-trem, trem);
+      trem = 1.0 - (depth * modulators->tremolo[i].value(offset));
+      pulses[i].setRange(-trem, trem);
       // detune units for a chorus effect
       f *= 1.01;
     }    
@@ -7,6 +7,8 @@ class Voice {
   Sine carrier;
   Sine modulator;
   FM fm;
+  ControlClock control;
+  ControlValue modIndex;
   
   Voice() {
     fm.source = &carrier;
@@ -16,10 +18,10 @@ class Voice {
 
   float step(float f, float v, float *cv) {
     // the mod wheel changes the modulation index, altering the timbre
-    float modIndex = 2.5 + (cv[1] * 10.0);
+    if (control.tick()) modIndex.set(2.5 + (cv[1] * 10.0));
     carrier.frequency = f;
     modulator.frequency = f * 0.25;
-    float modDelta = modulator.frequency * modIndex;
+    float modDelta = modulator.frequency * modIndex.step();
     modulator.setRange(-modDelta, modDelta);
     return(fm.step() * v);
   }
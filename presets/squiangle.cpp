@@ -14,6 +14,10 @@ class Voice {
     env = new ADSR(0.10, 0.05, 0.5, 0.40);
   }
 
+  // restart the envelope even when a note is played over a held one
+  void noteOn(float v) { env->noteOn(v); }
+  void noteOff() { env->noteOff(); }
+
   float step(float f, float v, float *cv) {
     // the mod wheel changes the shape of the wave from a triangle to a square
     if (cv[1] != timbre) {
@@ -0,0 +1,160 @@
+#ifndef CSYNTH_STATS_H
+#define CSYNTH_STATS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+// the width of each bucket in the load histogram as a fraction of the
+//  realtime budget for a block
+#define LOAD_BUCKET_WIDTH 0.025
+// the number of buckets in the load histogram, where the last bucket counts
+//  all blocks that took longer than their budget
+#define LOAD_BUCKET_COUNT 41
+// the number of seconds of audio between reports of load statistics
+#define LOAD_REPORT_INTERVAL 0.5
+
+// indices of load statistics when packed into an array of floats
+typedef enum {
+  // the number of blocks measured
+  LOAD_BLOCKS = 0,
+  // the mean load over the most recent report interval
+  LOAD_RECENT = 1,
+  // the mean load over all blocks
+  LOAD_MEAN = 2,
+  // the highest load of any block
+  LOAD_WORST = 3,
+  // the number of blocks that took longer than their budget
+  LOAD_XRUNS = 4,
+  // the number of voices sounding at the end of the last block
+  LOAD_VOICES = 5,
+  // the most voices sounding at the end of any block
+  LOAD_MAX_VOICES = 6,
+  // the mean and longest time to process a block in microseconds
+  LOAD_BLOCK_TIME = 7,
+  LOAD_WORST_BLOCK_TIME = 8,
+  // the mean time spent handling events in a block in microseconds
+  LOAD_EVENT_TIME = 9,
+  // the counts of blocks in each histogram bucket
+  LOAD_HISTOGRAM = 10
+} LoadStatIndex;
+#define LOAD_STAT_COUNT (LOAD_HISTOGRAM + LOAD_BUCKET_COUNT)
+
+typedef struct {
+  uint32_t blocks;
+  uint32_t xruns;
+  // total processing time and budget in seconds
+  double time;
+  double budget;
+  double event_time;
+  // processing time and budget since the last report
+  double recent_time;
+  double recent_budget;
+  // the worst block seen
+  float worst_load;
+  double worst_time;
+  // voice usage
+  int voices;
+  int max_voices;
+  // the number of blocks falling into each load bucket
+  uint32_t histogram[LOAD_BUCKET_COUNT];
+} LoadStats;
+
+static inline void init_load_stats(LoadStats *stats) {
+  memset(stats, 0, sizeof(LoadStats));
+}
+
+// record the time taken to process a block, returning whether enough audio
+//  has been processed since the last report to send another one
+static inline int record_load(LoadStats *stats, double time, double budget,
+                              double event_time, int voices) {
+  if (! (budget > 0.0)) return(0);
+  float load = (float)(time / budget);
+  int bucket = (int)(load / LOAD_BUCKET_WIDTH);
+  if ((load > 1.0) || (bucket >= LOAD_BUCKET_COUNT)) {
+    bucket = LOAD_BUCKET_COUNT - 1;
+    stats->xruns++;
+  }
+  stats->histogram[bucket]++;
+  stats->blocks++;
+  stats->time += time;
+  stats->budget += budget;
+  stats->event_time += event_time;
+  stats->recent_time += time;
+  stats->recent_budget += budget;
+  if (load > stats->worst_load) stats->worst_load = load;
+  if (time > stats->worst_time) stats->worst_time = time;
+  stats->voices = voices;
+  if (voices > stats->max_voices) stats->max_voices = voices;
+  return(stats->recent_budget >= LOAD_REPORT_INTERVAL);
+}
+
+// pack statistics into an array of LOAD_STAT_COUNT floats for sending,
+//  starting a new report interval
+static inline void pack_load_stats(LoadStats *stats, float *array) {
+  int i;
+  double blocks = (stats->blocks > 0) ? (double)stats->blocks : 1.0;
+  array[LOAD_BLOCKS] = (float)stats->blocks;
+  array[LOAD_RECENT] = (stats->recent_budget > 0.0) ?
+    (float)(stats->recent_time / stats->recent_budget) : 0.0;
+  array[LOAD_MEAN] = (stats->budget > 0.0) ?
+    (float)(stats->time / stats->budget) : 0.0;
+  array[LOAD_WORST] = stats->worst_load;
+  array[LOAD_XRUNS] = (float)stats->xruns;
+  array[LOAD_VOICES] = (float)stats->voices;
+  array[LOAD_MAX_VOICES] = (float)stats->max_voices;
+  array[LOAD_BLOCK_TIME] = (float)((stats->time / blocks) * 1.0e6);
+  array[LOAD_WORST_BLOCK_TIME] = (float)(stats->worst_time * 1.0e6);
+  array[LOAD_EVENT_TIME] = (float)((stats->event_time / blocks) * 1.0e6);
+  for (i = 0; i < LOAD_BUCKET_COUNT; i++) {
+    array[LOAD_HISTOGRAM + i] = (float)stats->histogram[i];
+  }
+  stats->recent_time = stats->recent_budget = 0.0;
+}
+
+// estimate the load that the given fraction of blocks came in under from
+//  a packed histogram, returning the upper edge of the bucket it falls in
+static inline float load_percentile(const float *array, float fraction) {
+  float target = array[LOAD_BLOCKS] * fraction;
+  float count = 0.0;
+  int i;
+  if (! (array[LOAD_BLOCKS] > 0.0)) return(0.0);
+  for (i = 0; i < LOAD_BUCKET_COUNT - 1; i++) {
+    count += array[LOAD_HISTOGRAM + i];
+    if (count >= target) return((float)(i + 1) * LOAD_BUCKET_WIDTH);
+  }
+  // anything past the last regular bucket is over budget, so the worst
+  //  case is the best estimate we have
+  return(array[LOAD_WORST]);
+}
+
+// write packed statistics to a file as JSON
+static inline void write_load_report(FILE *f, const float *array) {
+  int i;
+  fprintf(f, "{\n");
+  fprintf(f, "  \"blocks\": %.0f,\n", array[LOAD_BLOCKS]);
+  fprintf(f, "  \"recent_load\": %g,\n", array[LOAD_RECENT]);
+  fprintf(f, "  \"mean_load\": %g,\n", array[LOAD_MEAN]);
+  fprintf(f, "  \"worst_load\": %g,\n", array[LOAD_WORST]);
+  fprintf(f, "  \"percentiles\": {\n");
+  fprintf(f, "    \"50\": %g,\n", load_percentile(array, 0.5));
+  fprintf(f, "    \"90\": %g,\n", load_percentile(array, 0.9));
+  fprintf(f, "    \"99\": %g,\n", load_percentile(array, 0.99));
+  fprintf(f, "    \"99.9\": %g\n", load_percentile(array, 0.999));
+  fprintf(f, "  },\n");
+  fprintf(f, "  \"xruns\": %.0f,\n", array[LOAD_XRUNS]);
+  fprintf(f, "  \"voices\": %.0f,\n", array[LOAD_VOICES]);
+  fprintf(f, "  \"max_voices\": %.0f,\n", array[LOAD_MAX_VOICES]);
+  fprintf(f, "  \"mean_block_us\": %g,\n", array[LOAD_BLOCK_TIME]);
+  fprintf(f, "  \"worst_block_us\": %g,\n", array[LOAD_WORST_BLOCK_TIME]);
+  fprintf(f, "  \"mean_event_us\": %g,\n", array[LOAD_EVENT_TIME]);
+  fprintf(f, "  \"histogram_bucket_width\": %g,\n", LOAD_BUCKET_WIDTH);
+  fprintf(f, "  \"histogram\": [");
+  for (i = 0; i < LOAD_BUCKET_COUNT; i++) {
+    fprintf(f, "%s%.0f", (i > 0) ? ", " : "", array[LOAD_HISTOGRAM + i]);
+  }
+  fprintf(f, "]\n");
+  fprintf(f, "}\n");
+}
+
+#endif
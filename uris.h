@@ -18,8 +18,19 @@
 #define CSYNTH__autobuild    CSYNTH_URI "#autobuild"
 #define CSYNTH__bendrange    CSYNTH_URI "#bendrange"
 #define CSYNTH__polyphony    CSYNTH_URI "#polyphony"
+#define CSYNTH__stealing     CSYNTH_URI "#stealing"
+#define CSYNTH__loadceiling  CSYNTH_URI "#loadceiling"
+#define CSYNTH__voicelimit   CSYNTH_URI "#voicelimit"
+#define CSYNTH__loadstats    CSYNTH_URI "#loadstats"
+#define CSYNTH__profile      CSYNTH_URI "#profile"
+#define CSYNTH__profilereport CSYNTH_URI "#profilereport"
+#define CSYNTH__buildoutput  CSYNTH_URI "#buildoutput"
+#define CSYNTH__dependencies CSYNTH_URI "#dependencies"
+#define CSYNTH__crossfade    CSYNTH_URI "#crossfade"
 #define CSYNTH__cv           CSYNTH_URI "#cv"
 #define CSYNTH__disposeLib   CSYNTH_URI "#disposeLib"
+#define CSYNTH__resizeContext CSYNTH_URI "#resizeContext"
+#define CSYNTH__disposeVoices CSYNTH_URI "#disposeVoices"
 
 typedef struct {
   LV2_URID atom_Tuple;
@@ -32,9 +43,20 @@ typedef struct {
 	LV2_URID csynth_codepath;
 	LV2_URID csynth_autobuild;
 	LV2_URID csynth_polyphony;
+	LV2_URID csynth_stealing;
+	LV2_URID csynth_loadceiling;
+	LV2_URID csynth_voicelimit;
+	LV2_URID csynth_loadstats;
+	LV2_URID csynth_profile;
+	LV2_URID csynth_profilereport;
+	LV2_URID csynth_buildoutput;
+	LV2_URID csynth_dependencies;
+	LV2_URID csynth_crossfade;
 	LV2_URID csynth_bendrange;
 	LV2_URID csynth_cv;
 	LV2_URID csynth_disposeLib;
+	LV2_URID csynth_resizeContext;
+	LV2_URID csynth_disposeVoices;
 	LV2_URID midi_Event;
 	LV2_URID patch_Get;
 	LV2_URID patch_Set;
@@ -54,9 +76,20 @@ static inline void map_csynth_uris(LV2_URID_Map *map, CsynthURIs *uris) {
   uris->csynth_codepath     = map->map(map->handle, CSYNTH__codepath);
   uris->csynth_autobuild    = map->map(map->handle, CSYNTH__autobuild);
   uris->csynth_polyphony    = map->map(map->handle, CSYNTH__polyphony);
+  uris->csynth_stealing     = map->map(map->handle, CSYNTH__stealing);
+  uris->csynth_loadceiling  = map->map(map->handle, CSYNTH__loadceiling);
+  uris->csynth_voicelimit   = map->map(map->handle, CSYNTH__voicelimit);
+  uris->csynth_loadstats    = map->map(map->handle, CSYNTH__loadstats);
+  uris->csynth_profile      = map->map(map->handle, CSYNTH__profile);
+  uris->csynth_profilereport = map->map(map->handle, CSYNTH__profilereport);
+  uris->csynth_buildoutput  = map->map(map->handle, CSYNTH__buildoutput);
+  uris->csynth_dependencies = map->map(map->handle, CSYNTH__dependencies);
+  uris->csynth_crossfade    = map->map(map->handle, CSYNTH__crossfade);
   uris->csynth_bendrange    = map->map(map->handle, CSYNTH__bendrange);
   uris->csynth_cv           = map->map(map->handle, CSYNTH__cv);
   uris->csynth_disposeLib   = map->map(map->handle, CSYNTH__disposeLib);
+  uris->csynth_resizeContext = map->map(map->handle, CSYNTH__resizeContext);
+  uris->csynth_disposeVoices = map->map(map->handle, CSYNTH__disposeVoices);
   uris->midi_Event          = map->map(map->handle, LV2_MIDI__MidiEvent);
   uris->patch_Get           = map->map(map->handle, LV2_PATCH__Get);
   uris->patch_Set           = map->map(map->handle, LV2_PATCH__Set);
@@ -81,6 +114,22 @@ LV2_Atom *write_set_path(LV2_Atom_Forge *forge, const CsynthURIs *uris,
 	lv2_atom_forge_pop(forge, &frame);
 	return(set);
 }
+// write an atom that sets a patch property to a string of text
+LV2_Atom *write_set_string(LV2_Atom_Forge *forge, const CsynthURIs *uris,
+                           LV2_URID property, const char *text) {
+  // make the atom
+	LV2_Atom_Forge_Frame frame;
+	LV2_Atom* set = (LV2_Atom*)lv2_atom_forge_object(
+		forge, &frame, 0, uris->patch_Set);
+  // add the property set
+	lv2_atom_forge_key(forge, uris->patch_property);
+	lv2_atom_forge_urid(forge, property);
+	lv2_atom_forge_key(forge, uris->patch_value);
+	lv2_atom_forge_string(forge, text, strlen(text));
+  // return the atom
+	lv2_atom_forge_pop(forge, &frame);
+	return(set);
+}
 // write an atom containing an array of float values
 LV2_Atom *write_set_float_array(LV2_Atom_Forge *forge, const CsynthURIs *uris,
                                 LV2_URID property, float *array, 
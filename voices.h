@@ -0,0 +1,337 @@
+#ifndef CSYNTH_VOICES_H
+#define CSYNTH_VOICES_H
+
+#include <stdint.h>
+#include <math.h>
+
+#include "csynth.h"
+
+// the number of distinct MIDI note numbers
+#define NOTE_COUNT 128
+// a voice index marking the end of a list or a note with no voice
+#define NO_VOICE (-1)
+
+// policies for choosing which voice to steal when every voice is held
+typedef enum {
+  // steal the voice whose note started first
+  STEAL_OLDEST = 0,
+  // steal the voice with the lowest recent output level
+  STEAL_QUIETEST = 1,
+  // reuse the voice that last played the same note, otherwise the oldest
+  STEAL_SAME_NOTE = 2
+} StealPolicy;
+#define STEAL_POLICY_COUNT 3
+
+// the lists a voice can be in
+typedef enum {
+  // voices that have never played or have been reset
+  FREE_VOICES = 0,
+  // voices playing a note that is still held down
+  HELD_VOICES = 1,
+  // voices whose note was released, least recently released first
+  RELEASED_VOICES = 2,
+  // voices being faded out to reduce load
+  FADING_VOICES = 3
+} VoiceListIndex;
+#define VOICE_LIST_COUNT 4
+
+typedef struct {
+  // the currently playing MIDI note number
+  uint8_t note;
+  // note frequency in Hz
+  float frequency;
+  // note velocity (0.0 to 1.0)
+  float velocity;
+  // the sum of the voice's absolute output over the current block
+  float level_sum;
+  // the mean absolute output of the voice over the last block
+  float level;
+  // the gain applied to a fading voice's output
+  float gain;
+  // whether the current note took the voice over while it was still held
+  int retriggered;
+  // the list the voice is in and its neighbors in that list
+  int list;
+  int prev;
+  int next;
+  // the next voice holding the same note, if any
+  int next_held;
+} Voice;
+
+typedef struct {
+  int head;
+  int tail;
+  int count;
+} VoiceList;
+
+typedef struct {
+  // voice state
+  Voice voices[MAX_VOICE_COUNT];
+  // the number of voices in use
+  int voice_count;
+  // the number of voices allowed to sound at once, at most voice_count
+  int voice_limit;
+  // the amount to reduce a fading voice's gain by on each sample
+  float fade_step;
+  // doubly-linked lists partitioning the voices in use
+  VoiceList lists[VOICE_LIST_COUNT];
+  // the first voice holding each note, chained through next_held
+  int held[NOTE_COUNT];
+  // the voice that most recently started playing each note
+  int last[NOTE_COUNT];
+  // the unbent frequency of each note in Hz
+  float note_frequencies[NOTE_COUNT];
+  // the ratio to multiply note frequencies by to apply the current bend
+  float bend_ratio;
+  // how to choose a voice to steal
+  StealPolicy steal_policy;
+} VoiceManager;
+
+// LISTS **********************************************************************
+
+// add a voice to the end of a list
+static inline void push_voice(VoiceManager *vm, int list, int v) {
+  VoiceList *l = &vm->lists[list];
+  Voice *voice = &vm->voices[v];
+  voice->list = list;
+  voice->prev = l->tail;
+  voice->next = NO_VOICE;
+  if (l->tail != NO_VOICE) vm->voices[l->tail].next = v;
+  else l->head = v;
+  l->tail = v;
+  l->count++;
+}
+
+// remove a voice from whatever list it's in
+static inline void unlink_voice(VoiceManager *vm, int v) {
+  Voice *voice = &vm->voices[v];
+  VoiceList *l = &vm->lists[voice->list];
+  if (voice->prev != NO_VOICE) vm->voices[voice->prev].next = voice->next;
+  else l->head = voice->next;
+  if (voice->next != NO_VOICE) vm->voices[voice->next].prev = voice->prev;
+  else l->tail = voice->prev;
+  voice->prev = voice->next = NO_VOICE;
+  l->count--;
+}
+
+// remove a held voice from the chain of voices holding its note
+static inline void unhold_voice(VoiceManager *vm, int v) {
+  int *link = &vm->held[vm->voices[v].note];
+  while (*link != NO_VOICE) {
+    if (*link == v) {
+      *link = vm->voices[v].next_held;
+      break;
+    }
+    link = &vm->voices[*link].next_held;
+  }
+  vm->voices[v].next_held = NO_VOICE;
+}
+
+// LIFECYCLE ******************************************************************
+
+// put a voice into its initial state and add it to the free list
+static inline void reset_voice(VoiceManager *vm, int v) {
+  Voice *voice = &vm->voices[v];
+  voice->note = 0;
+  voice->frequency = 0.0;
+  voice->velocity = 0.0;
+  voice->level_sum = voice->level = 0.0;
+  voice->gain = 1.0;
+  voice->retriggered = 0;
+  voice->next_held = NO_VOICE;
+  push_voice(vm, FREE_VOICES, v);
+}
+
+static inline void init_voices(VoiceManager *vm) {
+  int i;
+  for (i = 0; i < VOICE_LIST_COUNT; i++) {
+    vm->lists[i].head = vm->lists[i].tail = NO_VOICE;
+    vm->lists[i].count = 0;
+  }
+  for (i = 0; i < NOTE_COUNT; i++) {
+    vm->held[i] = vm->last[i] = NO_VOICE;
+    vm->note_frequencies[i] = 440.0 * powf(2.0, (i - 69) / 12.0);
+  }
+  vm->bend_ratio = 1.0;
+  vm->steal_policy = STEAL_OLDEST;
+  vm->voice_count = vm->voice_limit = 0;
+  vm->fade_step = 1.0;
+}
+
+// change the number of voices in use, resetting any that are removed
+static inline void set_voice_count(VoiceManager *vm, int count) {
+  int v;
+  if (count < 0) count = 0;
+  if (count > MAX_VOICE_COUNT) count = MAX_VOICE_COUNT;
+  for (v = count; v < vm->voice_count; v++) {
+    if (vm->voices[v].list == HELD_VOICES) unhold_voice(vm, v);
+    if (vm->last[vm->voices[v].note] == v) vm->last[vm->voices[v].note] = NO_VOICE;
+    unlink_voice(vm, v);
+  }
+  for (v = vm->voice_count; v < count; v++) {
+    reset_voice(vm, v);
+  }
+  vm->voice_count = vm->voice_limit = count;
+}
+
+// get the number of voices that are playing or releasing a note
+static inline int sounding_voice_count(VoiceManager *vm) {
+  return(vm->lists[HELD_VOICES].count + vm->lists[RELEASED_VOICES].count);
+}
+
+// NOTES **********************************************************************
+
+// choose a held voice to take over when no other voice is available
+static inline int steal_voice(VoiceManager *vm) {
+  int v, quietest;
+  if (vm->steal_policy == STEAL_QUIETEST) {
+    quietest = vm->lists[HELD_VOICES].head;
+    for (v = quietest; v != NO_VOICE; v = vm->voices[v].next) {
+      if (vm->voices[v].level < vm->voices[quietest].level) quietest = v;
+    }
+    return(quietest);
+  }
+  return(vm->lists[HELD_VOICES].head);
+}
+
+// choose a voice to play a note, taking it out of any list it's in
+static inline int allocate_voice(VoiceManager *vm, uint8_t note) {
+  int v = NO_VOICE;
+  // retrigger the voice that last played the note if the policy says to
+  if (vm->steal_policy == STEAL_SAME_NOTE) {
+    v = vm->last[note];
+    if ((v != NO_VOICE) && (vm->voices[v].note != note)) v = NO_VOICE;
+  }
+  // prefer voices that aren't making sound if the limit allows it, 
+  //  then the least recently released
+  if ((v == NO_VOICE) && (sounding_voice_count(vm) < vm->voice_limit)) {
+    v = vm->lists[FREE_VOICES].head;
+  }
+  if (v == NO_VOICE) v = vm->lists[RELEASED_VOICES].head;
+  if (v == NO_VOICE) v = steal_voice(vm);
+  if (v == NO_VOICE) v = vm->lists[FREE_VOICES].head;
+  if (v == NO_VOICE) v = vm->lists[FADING_VOICES].head;
+  if (v == NO_VOICE) return(NO_VOICE);
+  if (vm->voices[v].list == HELD_VOICES) unhold_voice(vm, v);
+  unlink_voice(vm, v);
+  return(v);
+}
+
+// start playing a note, returning the voice it was assigned to
+static inline int note_on(VoiceManager *vm, uint8_t note, float velocity) {
+  int v = allocate_voice(vm, note);
+  if (v == NO_VOICE) return(NO_VOICE);
+  Voice *voice = &vm->voices[v];
+  // the voice keeps the list it was taken from until it's added to another
+  voice->retriggered = (voice->list == HELD_VOICES);
+  voice->note = note;
+  voice->frequency = vm->note_frequencies[note] * vm->bend_ratio;
+  voice->velocity = velocity;
+  voice->gain = 1.0;
+  push_voice(vm, HELD_VOICES, v);
+  voice->next_held = vm->held[note];
+  vm->held[note] = v;
+  vm->last[note] = v;
+  return(v);
+}
+
+// release all voices holding a note
+static inline void note_off(VoiceManager *vm, uint8_t note) {
+  int v = vm->held[note];
+  int next;
+  while (v != NO_VOICE) {
+    next = vm->voices[v].next_held;
+    vm->voices[v].velocity = 0.0;
+    vm->voices[v].next_held = NO_VOICE;
+    unlink_voice(vm, v);
+    push_voice(vm, RELEASED_VOICES, v);
+    v = next;
+  }
+  vm->held[note] = NO_VOICE;
+}
+
+// change the velocity of all voices holding a note
+static inline void note_pressure(VoiceManager *vm, uint8_t note, float velocity) {
+  if (! (velocity > 0.0)) return;
+  int v;
+  for (v = vm->held[note]; v != NO_VOICE; v = vm->voices[v].next_held) {
+    vm->voices[v].velocity = velocity;
+  }
+}
+
+// apply a pitch bend in semitones to all sounding voices
+static inline void bend_voices(VoiceManager *vm, float semitones) {
+  int list, v;
+  vm->bend_ratio = powf(2.0, semitones / 12.0);
+  for (list = HELD_VOICES; list <= FADING_VOICES; list++) {
+    for (v = vm->lists[list].head; v != NO_VOICE; v = vm->voices[v].next) {
+      vm->voices[v].frequency =
+        vm->note_frequencies[vm->voices[v].note] * vm->bend_ratio;
+    }
+  }
+}
+
+// FADING *********************************************************************
+
+// start fading out the quietest voice, preferring released voices, and 
+//  return whether there was a voice to fade
+static inline int fade_quietest_voice(VoiceManager *vm) {
+  int list, v, quietest;
+  for (list = RELEASED_VOICES; list >= HELD_VOICES; list--) {
+    quietest = vm->lists[list].head;
+    if (quietest == NO_VOICE) continue;
+    for (v = quietest; v != NO_VOICE; v = vm->voices[v].next) {
+      if (vm->voices[v].level < vm->voices[quietest].level) quietest = v;
+    }
+    if (list == HELD_VOICES) unhold_voice(vm, quietest);
+    unlink_voice(vm, quietest);
+    push_voice(vm, FADING_VOICES, quietest);
+    return(1);
+  }
+  return(0);
+}
+
+// return voices that have faded to silence to the free list
+static inline void finish_fades(VoiceManager *vm) {
+  int v = vm->lists[FADING_VOICES].head;
+  int next;
+  while (v != NO_VOICE) {
+    next = vm->voices[v].next;
+    if (! (vm->voices[v].gain > 0.0)) {
+      unlink_voice(vm, v);
+      reset_voice(vm, v);
+    }
+    v = next;
+  }
+}
+
+// RENDERING ******************************************************************
+
+// get the indices of all voices in a range of lists, returning the count
+static inline int list_voices(VoiceManager *vm, int first_list, int last_list, 
+                              int *indices) {
+  int list, v;
+  int count = 0;
+  for (list = first_list; list <= last_list; list++) {
+    for (v = vm->lists[list].head; v != NO_VOICE; v = vm->voices[v].next) {
+      indices[count++] = v;
+    }
+  }
+  return(count);
+}
+
+// update the output level of sounding voices at the end of a block
+static inline void update_voice_levels(VoiceManager *vm, uint32_t sample_count) {
+  if (sample_count == 0) return;
+  int list, v;
+  Voice *voice;
+  for (list = HELD_VOICES; list <= RELEASED_VOICES; list++) {
+    for (v = vm->lists[list].head; v != NO_VOICE; v = vm->voices[v].next) {
+      voice = &vm->voices[v];
+      voice->level = voice->level_sum / (float)sample_count;
+      voice->level_sum = 0.0;
+    }
+  }
+}
+
+#endif